@@ -0,0 +1,514 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// Measures both manifest forms and VerifyFS in process, VerifyFS through its
+// fuse handlers called directly rather than through a kernel mount.  Results are
+// printed as one JSON object per line so runs can be compared by script.
+//
+//   benchVerifyFS [entries...]     manifest sizes, default 1000 10000 100000 1000000
+//
+// Files of several sizes are written to a temporary source folder, so runs
+// after the first measure reads from the page cache.
+
+#include "VerifyFS.h"
+#include "FileVerifier.h"
+#include "CompiledFileVerifier.h"
+#include "DigestAlgorithms.h"
+#include "ReadEngines.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+// each measurement runs for at least this long and this many operations
+const double minSeconds = 0.5;
+const size_t minOperations = 20;
+
+// cheap operations are timed in batches, reporting per operation cost of the batches
+const size_t batchLength = 1000;
+
+// as the kernel would read, at most
+const size_t readLength = 128 * 1024;
+
+const char digestHex[] = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+
+// the cost of each operation of a measurement, in nanoseconds
+struct Samples
+{
+    Samples() : bytes(0), seconds(0) {}
+
+    void merge(const Samples& other)
+    {
+        ns.insert(ns.end(), other.ns.begin(), other.ns.end());
+        bytes += other.bytes;
+    }
+
+    vector<double> ns;
+    size_t bytes;
+    double seconds;
+};
+
+// one JSON object, printed as a line
+class Report
+{
+public:
+    Report(const char* benchmark) { mLine << fixed << setprecision(1) << "{\"benchmark\":\"" << benchmark << '"'; }
+
+    Report& field(const char* name, const string& value) { mLine << ",\"" << name << "\":\"" << value << '"'; return *this; }
+    Report& field(const char* name, const size_t value) { mLine << ",\"" << name << "\":" << value; return *this; }
+    Report& field(const char* name, const double value) { mLine << ",\"" << name << "\":" << value; return *this; }
+
+    // operations, their rate, throughput when bytes were moved, and percentiles
+    Report& samples(Samples& samples, const size_t operationsPerSample = 1)
+    {
+        sort(samples.ns.begin(), samples.ns.end());
+        const size_t operations = samples.ns.size() * operationsPerSample;
+        field("operations", operations);
+        field("ops_per_s", operations / samples.seconds);
+        if(0 != samples.bytes)
+            field("mb_per_s", samples.bytes / samples.seconds / (1024 * 1024));
+
+        field("p50_ns", percentile(samples.ns, 50));
+        field("p99_ns", percentile(samples.ns, 99));
+        field("max_ns", samples.ns.back());
+        return *this;
+    }
+
+    ~Report()
+    {
+        mLine << '}';
+        printf("%s\n", mLine.str().c_str());
+        fflush(stdout);
+    }
+
+private:
+    static double percentile(const vector<double>& sorted, const size_t p)
+    {
+        return sorted[min(sorted.size() - 1, (sorted.size() * p) / 100)];
+    }
+
+private:
+    ostringstream mLine;
+};
+
+// runs operation until the measurement's time and count are reached, it returns bytes moved
+Samples measure(const function<size_t()>& operation)
+{
+    Samples samples;
+    const Clock::time_point start = Clock::now();
+    Clock::time_point now = start;
+    while((samples.ns.size() < minOperations) || (chrono::duration<double>(now - start).count() < minSeconds))
+    {
+        const Clock::time_point before = now;
+        samples.bytes += operation();
+        now = Clock::now();
+        samples.ns.push_back(chrono::duration<double, nano>(now - before).count());
+    }
+
+    samples.seconds = chrono::duration<double>(now - start).count();
+    return samples;
+}
+
+// measure, with threadCount threads each running operation with their own index
+Samples measureConcurrently(const size_t threadCount, const function<size_t(size_t)>& operation)
+{
+    vector<Samples> perThread(threadCount);
+    vector<thread> threads;
+    const Clock::time_point start = Clock::now();
+    size_t t;
+    for(t = 0; t < threadCount; t++)
+        threads.push_back(thread([&, t]() { perThread[t] = measure([&, t]() { return operation(t); }); }));
+
+    Samples samples;
+    for(t = 0; t < threadCount; t++)
+    {
+        threads[t].join();
+        samples.merge(perThread[t]);
+    }
+
+    samples.seconds = chrono::duration<double>(Clock::now() - start).count();
+    return samples;
+}
+
+string manifestOfSize(const size_t entries, vector<string>& paths)
+{
+    // roughly a hundred files per directory, two levels deep
+    string manifest;
+    char path[64];
+    size_t i;
+    for(i = 0; i < entries; i++)
+    {
+        snprintf(path, sizeof(path), "dir%04zu/sub%02zu/file%07zu.dat", i / 10000, (i / 100) % 100, i);
+        paths.push_back(path);
+        manifest += string(digestHex) + "  " + path + "\n";
+    }
+
+    return manifest;
+}
+
+// times lookups of the queries in batches, reporting per lookup cost of the batches
+template<typename Lookup>
+void benchLookups(const char* verifier, const char* operation, const size_t entries, const vector<string>& queries, Lookup lookup)
+{
+    size_t next = 0;
+    size_t found = 0;
+    Samples batches = measure([&]() {
+        size_t i;
+        for(i = 0; i < batchLength; i++)
+            found += lookup(queries[next++ % queries.size()]);
+        return 0;
+    });
+
+    // keeps the lookups from being optimised away
+    if(found > batches.ns.size() * batchLength)
+        abort();
+
+    for(double& batch : batches.ns)
+        batch /= batchLength;
+
+    Report("manifest_lookup").field("verifier", verifier).field("operation", operation)
+            .field("entries", entries).samples(batches, batchLength);
+}
+
+template<typename Verifier>
+void benchVerifier(const char* name, const Verifier& verifier, const size_t entries,
+                   const vector<string>& hits, const vector<string>& misses, const vector<string>& directories)
+{
+    benchLookups(name, "file_hit", entries, hits, [&](const string& p) { return verifier.isValidFilePath(p); });
+    benchLookups(name, "file_miss", entries, misses, [&](const string& p) { return verifier.isValidFilePath(p); });
+    benchLookups(name, "directory_hit", entries, directories, [&](const string& p) { return verifier.isValidDirectoryPath(p); });
+}
+
+void benchManifest(const size_t entries, mt19937& random)
+{
+    vector<string> paths;
+    const string manifest = manifestOfSize(entries, paths);
+
+    const Clock::time_point start = Clock::now();
+    stringstream digests(manifest);
+    FileVerifier verifier(digests);
+    Report("manifest_parse").field("entries", entries)
+            .field("ms", chrono::duration<double, milli>(Clock::now() - start).count());
+
+    char compiledPath[] = "/tmp/benchVerifyFS.XXXXXX";
+    close(mkstemp(compiledPath));
+    {
+        ofstream out(compiledPath, ios::binary);
+        verifier.compile(out);
+    }
+
+    // random order defeats any locality from the manifest's own ordering
+    vector<string> hits(paths);
+    shuffle(hits.begin(), hits.end(), random);
+
+    vector<string> misses(hits);
+    for(string& m : misses)
+        m.back() = 'x';
+
+    vector<string> directories;
+    for(const string& h : hits)
+        directories.push_back(h.substr(0, h.rfind('/')));
+
+    benchVerifier("digests", verifier, entries, hits, misses, directories);
+    {
+        CompiledFileVerifier compiled(compiledPath);
+        benchVerifier("compiled", compiled, entries, hits, misses, directories);
+    }
+    unlink(compiledPath);
+
+    // the ordered map, building a std::string per query, that the verifiers used to search
+    map<const string, int> reference;
+    for(const string& p : paths)
+        reference.insert(make_pair(p, 0));
+
+    benchLookups("reference_map", "file_hit", entries, hits, [&](const string& p) { return reference.end() != reference.find(p); });
+    benchLookups("reference_map", "file_miss", entries, misses, [&](const string& p) { return reference.end() != reference.find(p); });
+}
+
+void benchDigests(const IDigestAlgorithm& algorithm, mt19937& random)
+{
+    for(const size_t length : { 4 * 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 })
+    {
+        vector<uint8_t> data(length);
+        for(uint8_t& d : data)
+            d = random();
+
+        Digest digest;
+        algorithm.digest(data.data(), data.size(), digest);
+
+        stringstream digests("#algorithm " + string(algorithm.name()) + "\n" + digestToHex(digest) + "  file.dat\n");
+        FileVerifier verifier(digests);
+
+        Samples samples = measure([&]() {
+            if(!verifier.isValidFileBlob("file.dat", data.data(), data.size()))
+                abort();
+            return data.size();
+        });
+
+        Report("verify_blob").field("algorithm", algorithm.name()).field("bytes", length).samples(samples);
+    }
+}
+
+// a source folder of files of several sizes, with their manifest
+class SourceTree
+{
+public:
+    struct Group
+    {
+        const char* name;
+        size_t length;
+        size_t count;
+        vector<string> paths;
+    };
+
+    SourceTree(mt19937& random) :
+        mGroups({ { "small", 4 * 1024, 500, {} }, { "medium", 1024 * 1024, 16, {} }, { "large", 32 * 1024 * 1024, 2, {} } })
+    {
+        char root[] = "/tmp/benchVerifyFS.XXXXXX";
+        if(nullptr == mkdtemp(root))
+            abort();
+        mRoot = root;
+
+        const IDigestAlgorithm& algorithm = defaultDigestAlgorithm();
+        for(Group& group : mGroups)
+        {
+            mkdir((mRoot + '/' + group.name).c_str(), 0700);
+
+            vector<uint8_t> data(group.length);
+            size_t i;
+            for(i = 0; i < group.count; i++)
+            {
+                for(uint8_t& d : data)
+                    d = random();
+
+                char name[32];
+                snprintf(name, sizeof(name), "file%04zu.dat", i);
+                const string path = string(group.name) + '/' + name;
+                ofstream(mRoot + '/' + path, ios::binary).write(reinterpret_cast<const char*>(data.data()), data.size());
+
+                Digest digest;
+                algorithm.digest(data.data(), data.size(), digest);
+                mManifest += digestToHex(digest) + "  " + path + "\n";
+                group.paths.push_back('/' + path);
+            }
+        }
+    }
+
+    ~SourceTree()
+    {
+        for(const Group& group : mGroups)
+        {
+            for(const string& path : group.paths)
+                unlink((mRoot + path).c_str());
+            rmdir((mRoot + '/' + group.name).c_str());
+        }
+
+        rmdir(mRoot.c_str());
+    }
+
+    const string& root() const { return mRoot; }
+    const string& manifest() const { return mManifest; }
+    const vector<Group>& groups() const { return mGroups; }
+
+private:
+    string mRoot;
+    string mManifest;
+    vector<Group> mGroups;
+};
+
+// opens, reads in full and releases a file, as a process reading it would
+size_t readFile(VerifyFS& sut, const char* path, vector<char>& buffer)
+{
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+    fi.flags = O_RDONLY;
+    if(0 != sut.fuseOpen(path, &fi))
+        abort();
+
+    size_t offset = 0;
+    int bytesRead;
+    while(0 < (bytesRead = sut.fuseRead(buffer.data(), buffer.size(), offset, &fi)))
+        offset += bytesRead;
+
+    sut.fuseRelease(&fi);
+    if(bytesRead < 0)
+        abort();
+
+    return offset;
+}
+
+int countEntry(void* buf, const char*, const struct stat*, off_t)
+{
+    (*static_cast<size_t*>(buf))++;
+    return 0;
+}
+
+void benchVerifyFS(const SourceTree& tree, const char* content, const VerifyFS::Options& options)
+{
+    stringstream digests(tree.manifest());
+    FileVerifier verifier(digests);
+    VerifyFS sut(tree.root(), verifier, options);
+    const char* cache = (0 == options.cacheSize) ? "none" : "retained";
+
+    for(const SourceTree::Group& group : tree.groups())
+    {
+        vector<char> buffer(readLength);
+        size_t next = 0;
+        Samples samples = measure([&]() { return readFile(sut, group.paths[next++ % group.paths.size()].c_str(), buffer); });
+        Report("open_read_release").field("content", content).field("cache", cache)
+                .field("file_bytes", group.length).samples(samples);
+    }
+
+    // every file read by every thread, verifying or sharing the same content
+    const SourceTree::Group& medium = tree.groups()[1];
+    for(const size_t threadCount : { 1, 2, 4, 8 })
+    {
+        vector<vector<char>> buffers(threadCount, vector<char>(readLength));
+        vector<size_t> next(threadCount, 0);
+        Samples samples = measureConcurrently(threadCount, [&](size_t t) {
+            return readFile(sut, medium.paths[(t + next[t]++) % medium.paths.size()].c_str(), buffers[t]);
+        });
+        Report("concurrent_readers").field("content", content).field("cache", cache)
+                .field("threads", threadCount).field("file_bytes", medium.length).samples(samples);
+    }
+}
+
+void benchAttributes(const SourceTree& tree)
+{
+    stringstream digests(tree.manifest());
+    FileVerifier verifier(digests);
+    VerifyFS sut(tree.root(), verifier);
+    const SourceTree::Group& small = tree.groups()[0];
+
+    for(const size_t threadCount : { 1, 4 })
+    {
+        vector<size_t> next(threadCount, 0);
+        Samples samples = measureConcurrently(threadCount, [&](size_t t) {
+            struct stat attributes;
+            size_t i;
+            for(i = 0; i < batchLength; i++)
+            {
+                if(0 != sut.fuseStat(small.paths[next[t]++ % small.paths.size()].c_str(), &attributes))
+                    abort();
+            }
+            return 0;
+        });
+
+        for(double& batch : samples.ns)
+            batch /= batchLength;
+
+        Report("getattr").field("threads", threadCount).samples(samples, batchLength);
+    }
+
+    size_t entries = 0;
+    Samples samples = measure([&]() {
+        struct fuse_file_info fi;
+        memset(&fi, 0, sizeof(fi));
+        if(0 != sut.fuseOpendir("/small", &fi))
+            abort();
+
+        sut.fuseReaddir("/small", &entries, countEntry, 0, &fi);
+        sut.fuseReleasedir("/small", &fi);
+        return 0;
+    });
+
+    Report("readdir").field("entries", small.count).samples(samples);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    vector<size_t> entries;
+    int i;
+    for(i = 1; i < argc; i++)
+        entries.push_back(strtoul(argv[i], nullptr, 10));
+
+    if(entries.empty())
+        entries = { 1000, 10000, 100000, 1000000 };
+
+    mt19937 random(1);
+    for(size_t e : entries)
+        benchManifest(e, random);
+
+    for(const char* name : { "sha256", "sha512-256", "blake3" })
+    {
+        const IDigestAlgorithm* algorithm = digestAlgorithmNamed(name);
+        if(nullptr != algorithm)
+            benchDigests(*algorithm, random);
+    }
+
+    SourceTree tree(random);
+    benchAttributes(tree);
+
+    VerifyFS::Options options;
+    for(const size_t cacheSize : { 0, 256 * 1024 * 1024 })
+    {
+        options.cacheSize = cacheSize;
+
+        options.useMmap = false;
+        benchVerifyFS(tree, "heap", options);
+
+        if(isIoUringAvailable())
+        {
+            options.useIoUring = true;
+            benchVerifyFS(tree, "heap_io_uring", options);
+            options.useIoUring = false;
+        }
+
+        options.useMmap = true;
+        benchVerifyFS(tree, "mmap", options);
+    }
+
+    return 0;
+}
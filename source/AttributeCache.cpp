@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "AttributeCache.h"
+
+using namespace std;
+
+AttributeCache::AttributeCache(const double timeoutSeconds) :
+    mTimeout(chrono::duration_cast<Clock::duration>(chrono::duration<double>(timeoutSeconds)))
+{
+    // initialiser list only
+}
+
+bool AttributeCache::find(const PathView& path, struct stat& attributes) const
+{
+    const uint64_t hash = PathIndex::hash(path);
+    const Shard& shard = shardFor(hash);
+    lock_guard<mutex> lock(shard.mLock);
+
+    const vector<Entry>& entries = shard.mEntries;
+    uint64_t index;
+    if(!shard.mIndex.find(hash, [&](uint64_t i) { return path == entries[i].path; }, index))
+        return false;
+
+    const Entry& entry = entries[index];
+    if(Clock::now() - entry.fetched >= mTimeout)
+        return false;
+
+    attributes = entry.attributes;
+    return true;
+}
+
+void AttributeCache::insert(const PathView& path, const struct stat& attributes)
+{
+    const uint64_t hash = PathIndex::hash(path);
+    Shard& shard = shardFor(hash);
+    lock_guard<mutex> lock(shard.mLock);
+
+    // refetched attributes replace the expired entry in place
+    vector<Entry>& entries = shard.mEntries;
+    uint64_t index;
+    if(!shard.mIndex.find(hash, [&](uint64_t i) { return path == entries[i].path; }, index))
+    {
+        index = entries.size();
+        entries.push_back(Entry());
+        entries.back().path = path.str();
+        shard.mIndex.insert(hash, index);
+    }
+
+    entries[index].attributes = attributes;
+    entries[index].fetched = Clock::now();
+}
+
+AttributeCache::Shard& AttributeCache::shardFor(const uint64_t hash)
+{
+    // the index probes by the low bits, so shard by the high ones
+    return mShards[hash >> 60];
+}
+
+const AttributeCache::Shard& AttributeCache::shardFor(const uint64_t hash) const
+{
+    return mShards[hash >> 60];
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef ATTRIBUTECACHE_H
+#define ATTRIBUTECACHE_H
+
+#include "PathIndex.h"
+#include <sys/stat.h>
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Attributes of backing files and directories, served from memory for a
+// timeout after they were fetched, after which the caller stats the backing
+// file again.  Holds whatever paths are inserted, so callers bound it by only
+// inserting manifest paths.
+class AttributeCache
+{
+public:
+    AttributeCache(const double timeoutSeconds);
+
+    // false when the path was never inserted or its attributes have expired
+    bool find(const PathView& path, struct stat& attributes) const;
+    void insert(const PathView& path, const struct stat& attributes);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry
+    {
+        std::string path;
+        struct stat attributes;
+        Clock::time_point fetched;
+    };
+
+    // independent locks keep concurrent getattrs of different paths apart
+    struct Shard
+    {
+        mutable std::mutex mLock;
+        std::vector<Entry> mEntries;
+        PathIndex mIndex;
+    };
+
+    Shard& shardFor(const uint64_t hash);
+    const Shard& shardFor(const uint64_t hash) const;
+
+private:
+    const Clock::duration mTimeout;
+    std::array<Shard, 16> mShards;
+};
+
+#endif // ATTRIBUTECACHE_H
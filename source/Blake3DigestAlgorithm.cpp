@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "Blake3DigestAlgorithm.h"
+
+#ifdef VERIFYFS_HAVE_BLAKE3
+
+#include <blake3.h>
+
+using namespace std;
+
+namespace {
+
+// below this the tree is too small for threads to pay for themselves
+const size_t parallelLength = 1 << 20;
+
+void updateHasher(blake3_hasher& hasher, const uint8_t* data, const size_t length)
+{
+#ifdef VERIFYFS_HAVE_BLAKE3_TBB
+    if(length >= parallelLength)
+        blake3_hasher_update_tbb(&hasher, data, length);
+    else
+#endif
+        blake3_hasher_update(&hasher, data, length);
+}
+
+class Blake3DigestContext : public IDigestContext
+{
+public:
+    Blake3DigestContext()
+    {
+        blake3_hasher_init(&mHasher);
+    }
+
+    virtual bool update(const uint8_t* data, const size_t length)
+    {
+        updateHasher(mHasher, data, length);
+        return true;
+    }
+
+    virtual bool finish(Digest& digest)
+    {
+        blake3_hasher_finalize(&mHasher, digest.data(), digest.size());
+        return true;
+    }
+
+private:
+    blake3_hasher mHasher;
+};
+
+} // namespace
+
+IDigestAlgorithm::Id Blake3DigestAlgorithm::id() const
+{
+    return blake3;
+}
+
+const char* Blake3DigestAlgorithm::name() const
+{
+    return "blake3";
+}
+
+bool Blake3DigestAlgorithm::digest(const uint8_t* data, const size_t length, Digest& digest) const
+{
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+
+    updateHasher(hasher, data, length);
+    blake3_hasher_finalize(&hasher, digest.data(), digest.size());
+    return true;
+}
+
+unique_ptr<IDigestContext> Blake3DigestAlgorithm::createContext() const
+{
+    return unique_ptr<IDigestContext>(new Blake3DigestContext());
+}
+
+#endif // VERIFYFS_HAVE_BLAKE3
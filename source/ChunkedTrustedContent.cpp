@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "ChunkedTrustedContent.h"
+#include <algorithm>
+#include <errno.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+ChunkedTrustedContent::ChunkedTrustedContent(int fd, size_t length, const IFileVerifier& fileVerifier, const string& path) :
+    mFd(dup(fd)),
+    mBuffer(nullptr),
+    mLength(length),
+    mFileVerifier(fileVerifier),
+    mPath(path),
+    mChunkSize(fileVerifier.chunkSize(path)),
+    mChunkCount(fileVerifier.chunkCount(path)),
+    mVerifiedChunks(new atomic<bool>[mChunkCount])
+{
+    size_t index;
+    for(index = 0; index < mChunkCount; index++)
+        mVerifiedChunks[index] = false;
+
+    if(-1 == mFd)
+        throw runtime_error("Unable to duplicate untrusted file");
+
+    // a file that has grown or shrunk can never verify
+    if((0 == mChunkSize) || (((mLength + mChunkSize - 1) / mChunkSize) != mChunkCount))
+    {
+        close(mFd);
+        throw runtime_error("Untrusted file length does not match chunk digests");
+    }
+
+    if(0 != mLength)
+    {
+        // pages are only committed as chunks are verified into them
+        void* mapping = mmap(nullptr, mLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(MAP_FAILED == mapping)
+        {
+            close(mFd);
+            throw runtime_error("Unable to allocate chunk buffer");
+        }
+
+        mBuffer = static_cast<uint8_t*>(mapping);
+    }
+}
+
+ChunkedTrustedContent::~ChunkedTrustedContent()
+{
+    if(nullptr != mBuffer)
+        munmap(mBuffer, mLength);
+
+    close(mFd);
+}
+
+const uint8_t* ChunkedTrustedContent::data() const
+{
+    return mBuffer;
+}
+
+size_t ChunkedTrustedContent::size() const
+{
+    return mLength;
+}
+
+bool ChunkedTrustedContent::verifyRange(const size_t offset, const size_t length)
+{
+    if((0 == length) || (offset >= mLength))
+        return true;
+
+    const size_t first = offset / mChunkSize;
+    const size_t last = (min(offset + length, mLength) - 1) / mChunkSize;
+
+    size_t index;
+    for(index = first; index <= last; index++)
+    {
+        if(!mVerifiedChunks[index].load(memory_order_acquire) && !verifyChunk(index))
+            return false;
+    }
+
+    return true;
+}
+
+bool ChunkedTrustedContent::verifyChunk(const size_t index)
+{
+    lock_guard<mutex> lock(mChunkLocks[index % mChunkLocks.size()]);
+
+    // another reader may have verified the chunk whilst we waited
+    if(mVerifiedChunks[index].load(memory_order_relaxed))
+        return true;
+
+    const size_t offset = index * mChunkSize;
+    const size_t length = min(mChunkSize, mLength - offset);
+
+    size_t bytesRead = 0;
+    while(bytesRead < length)
+    {
+        const ssize_t result = pread(mFd, mBuffer + offset + bytesRead, length - bytesRead, offset + bytesRead);
+        if((-1 == result) && (EINTR == errno))
+            continue;
+        else if(0 >= result)
+            return false;
+
+        bytesRead += result;
+    }
+
+    if(!mFileVerifier.isValidFileChunk(mPath, index, mBuffer + offset, length))
+    {
+        cerr << "Failed validation:  " << mPath << " chunk " << index << endl;
+        return false;
+    }
+
+    mVerifiedChunks[index].store(true, memory_order_release);
+    return true;
+}
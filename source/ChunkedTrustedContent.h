@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CHUNKEDTRUSTEDCONTENT_H
+#define CHUNKEDTRUSTEDCONTENT_H
+
+#include "ITrustedContent.h"
+#include "IFileVerifier.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Content verified lazily chunk by chunk against a manifest's merkle digests.
+// Chunks are read into a private anonymous mapping the first time a range
+// touching them is requested, so opening does no I/O beyond an fstat.  Readers
+// of verified chunks take no lock; a chunk is only ever filled and verified by
+// one thread, under its striped lock.
+class ChunkedTrustedContent : public ITrustedContent
+{
+public:
+    ChunkedTrustedContent(int fd, size_t length, const IFileVerifier& fileVerifier, const std::string& path);
+    virtual ~ChunkedTrustedContent();
+
+    // ITrustedContent interface
+    virtual const uint8_t* data() const;
+    virtual size_t size() const;
+    virtual bool verifyRange(const size_t offset, const size_t length);
+
+private:
+    ChunkedTrustedContent(const ChunkedTrustedContent&) = delete;
+    ChunkedTrustedContent& operator=(const ChunkedTrustedContent&) = delete;
+
+    bool verifyChunk(const size_t index);
+
+private:
+    const int mFd;
+    uint8_t* mBuffer;
+    const size_t mLength;
+    const IFileVerifier& mFileVerifier;
+    const std::string mPath;
+    const size_t mChunkSize;
+    const size_t mChunkCount;
+    std::unique_ptr<std::atomic<bool>[]> mVerifiedChunks;
+    std::array<std::mutex, 16> mChunkLocks;
+};
+
+#endif // CHUNKEDTRUSTEDCONTENT_H
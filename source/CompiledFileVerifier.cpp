@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "CompiledFileVerifier.h"
+#include "DigestAlgorithms.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+bool rangeFits(const uint64_t offset, const uint64_t length, const uint64_t limit)
+{
+    return (offset <= limit) && (length <= limit - offset);
+}
+
+bool tableFits(const uint64_t offset, const uint64_t count, const size_t entryLength, const size_t fileLength)
+{
+    return (offset <= fileLength) && (count <= (fileLength - offset) / entryLength);
+}
+
+bool indexFits(const uint64_t offset, const uint64_t slotCount, const uint64_t entryCount, const size_t fileLength)
+{
+    // a power of two, with at least one empty slot to end every probe
+    return (0 == (slotCount & (slotCount - 1))) && ((0 == entryCount) || (slotCount > entryCount))
+            && tableFits(offset, slotCount, sizeof(PathIndexSlot), fileLength);
+}
+
+} // namespace
+
+CompiledFileVerifier::CompiledFileVerifier(const string& manifestPath) :
+    mMapping(nullptr),
+    mLength(0)
+{
+    int fh = open(manifestPath.c_str(), O_RDONLY);
+    if(-1 == fh)
+        throw runtime_error("Unable to open compiled manifest");
+
+    struct stat details;
+    if((0 == fstat(fh, &details)) && (details.st_size >= static_cast<off_t>(sizeof(CompiledManifestHeader))))
+    {
+        mLength = details.st_size;
+        mMapping = mmap(nullptr, mLength, PROT_READ, MAP_PRIVATE, fh, 0);
+    }
+
+    close(fh);
+
+    if((nullptr == mMapping) || (MAP_FAILED == mMapping))
+        throw runtime_error("Unable to map compiled manifest");
+
+    const uint8_t* base = static_cast<const uint8_t*>(mMapping);
+    mHeader = reinterpret_cast<const CompiledManifestHeader*>(base);
+
+    if((0 != memcmp(mHeader->magic, compiledManifestMagic, sizeof(mHeader->magic)))
+            || (compiledManifestByteOrder != mHeader->byteOrder)
+            || (compiledManifestVersion != mHeader->version)
+            || (compiledManifestDigestLength != mHeader->digestLength)
+            || !tableFits(mHeader->fileTable, mHeader->fileCount, sizeof(CompiledManifestFileEntry), mLength)
+            || !tableFits(mHeader->directoryTable, mHeader->directoryCount, sizeof(CompiledManifestDirectoryEntry), mLength)
+            || !tableFits(mHeader->childTable, mHeader->childCount, sizeof(CompiledManifestChildEntry), mLength)
+            || !tableFits(mHeader->chunkDigestTable, mHeader->chunkDigestCount, compiledManifestDigestLength, mLength)
+            || !tableFits(mHeader->stringTable, mHeader->stringsLength, 1, mLength)
+            || !indexFits(mHeader->fileIndexTable, mHeader->fileIndexSlotCount, mHeader->fileCount, mLength)
+            || !indexFits(mHeader->directoryIndexTable, mHeader->directoryIndexSlotCount, mHeader->directoryCount, mLength))
+    {
+        munmap(mMapping, mLength);
+        throw runtime_error("Invalid compiled manifest");
+    }
+
+    mAlgorithm = digestAlgorithmWithId(mHeader->digestAlgorithm);
+    if(nullptr == mAlgorithm)
+    {
+        munmap(mMapping, mLength);
+        throw runtime_error("Unsupported digest algorithm in compiled manifest");
+    }
+
+    mFiles = reinterpret_cast<const CompiledManifestFileEntry*>(base + mHeader->fileTable);
+    mDirectories = reinterpret_cast<const CompiledManifestDirectoryEntry*>(base + mHeader->directoryTable);
+    mChildren = reinterpret_cast<const CompiledManifestChildEntry*>(base + mHeader->childTable);
+    mChunkDigests = base + mHeader->chunkDigestTable;
+    mStrings = reinterpret_cast<const char*>(base + mHeader->stringTable);
+    mFileIndex = reinterpret_cast<const PathIndexSlot*>(base + mHeader->fileIndexTable);
+    mDirectoryIndex = reinterpret_cast<const PathIndexSlot*>(base + mHeader->directoryIndexTable);
+}
+
+CompiledFileVerifier::~CompiledFileVerifier()
+{
+    munmap(mMapping, mLength);
+}
+
+bool CompiledFileVerifier::isCompiledManifest(const string& manifestPath)
+{
+    char magic[sizeof(compiledManifestMagic)];
+
+    bool isCompiled = false;
+    int fh = open(manifestPath.c_str(), O_RDONLY);
+    if(-1 != fh)
+    {
+        isCompiled = (sizeof(magic) == read(fh, magic, sizeof(magic)))
+                && (0 == memcmp(magic, compiledManifestMagic, sizeof(magic)));
+        close(fh);
+    }
+
+    return isCompiled;
+}
+
+bool CompiledFileVerifier::isValidDirectoryPath(const PathView& path) const
+{
+    // the root is present in the directory table but, as with the digests file, not reported
+    return !path.empty()
+            && (nullptr != find(mDirectories, mHeader->directoryCount, mDirectoryIndex, mHeader->directoryIndexSlotCount, path));
+}
+
+bool CompiledFileVerifier::isValidFilePath(const PathView& path) const
+{
+    return (nullptr != findFile(path));
+}
+
+bool CompiledFileVerifier::isValidFileBlob(const PathView& path, const uint8_t* data, const size_t length) const
+{
+    const CompiledManifestFileEntry* file = findFile(path);
+    if(nullptr == file)
+        return false;
+
+    if(0 == file->chunkCount)
+        return isValidDigest(file->digest, data, length);
+
+    if(((length + file->chunkSize - 1) / file->chunkSize) != file->chunkCount)
+        return false;
+
+    size_t index;
+    for(index = 0; index < file->chunkCount; index++)
+    {
+        const size_t offset = index * file->chunkSize;
+        if(!isValidChunk(*file, index, data + offset, min<size_t>(file->chunkSize, length - offset)))
+            return false;
+    }
+
+    return true;
+}
+
+bool CompiledFileVerifier::isValidFileDigest(const PathView& path, const Digest& digest) const
+{
+    const CompiledManifestFileEntry* file = findFile(path);
+    return (nullptr != file) && (0 == file->chunkCount) && isSameDigest(digest.data(), file->digest);
+}
+
+const IDigestAlgorithm& CompiledFileVerifier::digestAlgorithm() const
+{
+    return *mAlgorithm;
+}
+
+bool CompiledFileVerifier::contentDigest(const PathView& path, Digest& digest) const
+{
+    const CompiledManifestFileEntry* file = findFile(path);
+    if(nullptr == file)
+        return false;
+
+    memcpy(digest.data(), file->digest, digest.size());
+    return true;
+}
+
+size_t CompiledFileVerifier::chunkSize(const PathView& path) const
+{
+    const CompiledManifestFileEntry* file = findFile(path);
+    return ((nullptr != file) && (0 != file->chunkCount)) ? file->chunkSize : 0;
+}
+
+size_t CompiledFileVerifier::chunkCount(const PathView& path) const
+{
+    const CompiledManifestFileEntry* file = findFile(path);
+    return (nullptr != file) ? file->chunkCount : 0;
+}
+
+bool CompiledFileVerifier::isValidFileChunk(const PathView& path, const size_t index, const uint8_t* data, const size_t length) const
+{
+    const CompiledManifestFileEntry* file = findFile(path);
+    return (nullptr != file) && isValidChunk(*file, index, data, length);
+}
+
+bool CompiledFileVerifier::listDirectory(const PathView& path, vector<DirectoryChild>& children) const
+{
+    const CompiledManifestDirectoryEntry* directory = find(mDirectories, mHeader->directoryCount, mDirectoryIndex, mHeader->directoryIndexSlotCount, path);
+    if((nullptr == directory) || !rangeFits(directory->firstChild, directory->childCount, mHeader->childCount))
+        return false;
+
+    // the child table is already sorted by name
+    children.clear();
+    children.reserve(directory->childCount);
+
+    const CompiledManifestChildEntry* child = mChildren + directory->firstChild;
+    const CompiledManifestChildEntry* end = child + directory->childCount;
+    for(; child != end; child++)
+    {
+        // a listing with any name outside the strings is refused whole
+        if(!rangeFits(child->nameOffset, child->nameLength, mHeader->stringsLength))
+        {
+            children.clear();
+            return false;
+        }
+
+        children.push_back(DirectoryChild(PathView(mStrings + child->nameOffset, child->nameLength), 0 != (child->flags & CompiledManifestChildEntry::isDirectoryFlag)));
+    }
+
+    return true;
+}
+
+template<typename Entry>
+const Entry* CompiledFileVerifier::find(const Entry* table, const uint64_t count, const PathIndexSlot* slots, const uint64_t slotCount, const PathView& path) const
+{
+    // entries are bounds checked only as a lookup reaches them, so mapping stays O(1)
+    const char* strings = mStrings;
+    const uint64_t stringsLength = mHeader->stringsLength;
+    uint64_t index;
+    const bool found = PathIndex::find(slots, slotCount, PathIndex::hash(path), [&](uint64_t i) {
+        return (i < count) && rangeFits(table[i].pathOffset, table[i].pathLength, stringsLength)
+                && (path == PathView(strings + table[i].pathOffset, table[i].pathLength));
+    }, index);
+
+    return found ? &table[index] : nullptr;
+}
+
+const CompiledManifestFileEntry* CompiledFileVerifier::findFile(const PathView& path) const
+{
+    // a chunked entry whose digests lie outside their table is treated as unlisted
+    const CompiledManifestFileEntry* file = find(mFiles, mHeader->fileCount, mFileIndex, mHeader->fileIndexSlotCount, path);
+    if((nullptr != file) && (0 != file->chunkCount)
+            && ((0 == file->chunkSize) || !rangeFits(file->firstChunkDigest, file->chunkCount, mHeader->chunkDigestCount)))
+        return nullptr;
+
+    return file;
+}
+
+bool CompiledFileVerifier::isValidDigest(const uint8_t* expected, const uint8_t* data, const size_t length) const
+{
+    Digest digest;
+    return mAlgorithm->digest(data, length, digest) && isSameDigest(digest.data(), expected);
+}
+
+bool CompiledFileVerifier::isValidChunk(const CompiledManifestFileEntry& file, const size_t index, const uint8_t* data, const size_t length) const
+{
+    if((index >= file.chunkCount) || (length > file.chunkSize))
+        return false;
+
+    return isValidDigest(mChunkDigests + (file.firstChunkDigest + index) * compiledManifestDigestLength, data, length);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef COMPILEDFILEVERIFIER_H
+#define COMPILEDFILEVERIFIER_H
+
+#include "IFileVerifier.h"
+#include "CompiledManifest.h"
+
+// Verifier over a compiled manifest, see CompiledManifest.h.  The manifest is
+// mapped read-only and queried in place, so construction costs the same
+// however many entries it holds; each entry is bounds checked only as a lookup
+// reaches it, and one out of bounds is treated as unlisted.  Like the digests
+// file it is compiled from, the compiled manifest must be trusted.
+class CompiledFileVerifier : public IFileVerifier
+{
+public:
+    CompiledFileVerifier(const std::string& manifestPath);
+    virtual ~CompiledFileVerifier();
+
+    static bool isCompiledManifest(const std::string& manifestPath);
+
+    // IFileVerifier interface
+    virtual bool isValidDirectoryPath(const PathView& path) const;
+    virtual bool isValidFilePath(const PathView& path) const;
+    virtual bool isValidFileBlob(const PathView& path, const uint8_t* data, const size_t length) const;
+    virtual bool isValidFileDigest(const PathView& path, const Digest& digest) const;
+    virtual const IDigestAlgorithm& digestAlgorithm() const;
+    virtual bool contentDigest(const PathView& path, Digest& digest) const;
+    virtual size_t chunkSize(const PathView& path) const;
+    virtual size_t chunkCount(const PathView& path) const;
+    virtual bool isValidFileChunk(const PathView& path, const size_t index, const uint8_t* data, const size_t length) const;
+    virtual bool listDirectory(const PathView& path, std::vector<DirectoryChild>& children) const;
+
+private:
+    CompiledFileVerifier(const CompiledFileVerifier&) = delete;
+    CompiledFileVerifier& operator=(const CompiledFileVerifier&) = delete;
+
+    template<typename Entry>
+    const Entry* find(const Entry* table, const uint64_t count, const PathIndexSlot* slots, const uint64_t slotCount, const PathView& path) const;
+
+    const CompiledManifestFileEntry* findFile(const PathView& path) const;
+    bool isValidDigest(const uint8_t* expected, const uint8_t* data, const size_t length) const;
+    bool isValidChunk(const CompiledManifestFileEntry& file, const size_t index, const uint8_t* data, const size_t length) const;
+
+private:
+    void* mMapping;
+    size_t mLength;
+    const CompiledManifestHeader* mHeader;
+    const IDigestAlgorithm* mAlgorithm;
+    const CompiledManifestFileEntry* mFiles;
+    const CompiledManifestDirectoryEntry* mDirectories;
+    const CompiledManifestChildEntry* mChildren;
+    const PathIndexSlot* mFileIndex;
+    const PathIndexSlot* mDirectoryIndex;
+    const uint8_t* mChunkDigests;
+    const char* mStrings;
+};
+
+#endif // COMPILEDFILEVERIFIER_H
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "CompiledManifest.h"
+#include "IDigestAlgorithm.h"
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+struct ChildRecord
+{
+    string name;
+    bool isDirectory;
+    uint64_t index;
+    uint64_t pathOffset;
+    uint32_t pathLength;
+
+    bool operator<(const ChildRecord& other) const
+    {
+        return name < other.name;
+    }
+};
+
+string parentOf(const string& path)
+{
+    const size_t slash = path.rfind('/');
+    return (string::npos == slash) ? string() : path.substr(0, slash);
+}
+
+string nameOf(const string& path)
+{
+    const size_t slash = path.rfind('/');
+    return (string::npos == slash) ? path : path.substr(slash + 1);
+}
+
+uint64_t align(const uint64_t offset)
+{
+    return (offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+template<typename T>
+void writeTable(ostream& out, uint64_t& position, const uint64_t offset, const vector<T>& table)
+{
+    const vector<char> padding(offset - position, 0);
+    out.write(padding.data(), padding.size());
+    out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(T));
+    position = offset + table.size() * sizeof(T);
+}
+
+} // namespace
+
+static_assert(sizeof(Digest) == compiledManifestDigestLength, "compiled digests are stored raw");
+static_assert(sizeof(PathIndexSlot) == 16, "compiled index slots are stored raw");
+
+CompiledManifestWriter::CompiledManifestWriter() :
+    mDigestAlgorithm(IDigestAlgorithm::sha256)
+{
+    // initialiser list only
+}
+
+void CompiledManifestWriter::setDigestAlgorithm(const uint32_t algorithm)
+{
+    mDigestAlgorithm = algorithm;
+}
+
+void CompiledManifestWriter::addFile(const string& path, const Digest& digest, const size_t chunkSize, const vector<Digest>& chunkDigests)
+{
+    FileRecord& record = mFiles[path];
+    record.digest = digest;
+    record.chunkSize = chunkSize;
+    record.chunkDigests = chunkDigests;
+}
+
+void CompiledManifestWriter::write(ostream& out) const
+{
+    // every ancestor of a file is a directory, the root being the empty path
+    set<string> directories;
+    directories.insert(string());
+    for(const auto& f : mFiles)
+    {
+        string directory = parentOf(f.first);
+        while(directories.insert(directory).second)
+            directory = parentOf(directory);
+    }
+
+    map<string, uint64_t> directoryIndex;
+    for(const string& directory : directories)
+        directoryIndex.insert(make_pair(directory, directoryIndex.size()));
+
+    string strings;
+    vector<vector<ChildRecord>> children(directories.size());
+
+    vector<CompiledManifestFileEntry> files;
+    vector<Digest> chunkDigests;
+    for(const auto& f : mFiles)
+    {
+        CompiledManifestFileEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.pathOffset = strings.size();
+        entry.pathLength = f.first.length();
+        memcpy(entry.digest, f.second.digest.data(), compiledManifestDigestLength);
+        entry.chunkSize = f.second.chunkSize;
+        entry.firstChunkDigest = chunkDigests.size();
+        entry.chunkCount = f.second.chunkDigests.size();
+
+        strings += f.first;
+        chunkDigests.insert(chunkDigests.end(), f.second.chunkDigests.begin(), f.second.chunkDigests.end());
+
+        ChildRecord child = { nameOf(f.first), false, files.size(), entry.pathOffset, entry.pathLength };
+        children[directoryIndex[parentOf(f.first)]].push_back(child);
+        files.push_back(entry);
+    }
+
+    vector<CompiledManifestDirectoryEntry> directoryTable;
+    for(const string& directory : directories)
+    {
+        CompiledManifestDirectoryEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.pathOffset = strings.size();
+        entry.pathLength = directory.length();
+        strings += directory;
+
+        if(!directory.empty())
+        {
+            ChildRecord child = { nameOf(directory), true, directoryTable.size(), entry.pathOffset, entry.pathLength };
+            children[directoryIndex[parentOf(directory)]].push_back(child);
+        }
+
+        directoryTable.push_back(entry);
+    }
+
+    vector<CompiledManifestChildEntry> childTable;
+    size_t d;
+    for(d = 0; d < children.size(); d++)
+    {
+        sort(children[d].begin(), children[d].end());
+        directoryTable[d].firstChild = childTable.size();
+        directoryTable[d].childCount = children[d].size();
+
+        for(const ChildRecord& c : children[d])
+        {
+            CompiledManifestChildEntry entry;
+            memset(&entry, 0, sizeof(entry));
+            entry.nameLength = c.name.length();
+            entry.nameOffset = c.pathOffset + c.pathLength - entry.nameLength;
+            entry.flags = c.isDirectory ? CompiledManifestChildEntry::isDirectoryFlag : 0;
+            entry.index = c.index;
+            childTable.push_back(entry);
+        }
+    }
+
+    CompiledManifestHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, compiledManifestMagic, sizeof(header.magic));
+    header.byteOrder = compiledManifestByteOrder;
+    header.version = compiledManifestVersion;
+    header.digestLength = compiledManifestDigestLength;
+    header.digestAlgorithm = mDigestAlgorithm;
+    header.fileCount = files.size();
+    header.fileTable = align(sizeof(header));
+    header.directoryCount = directoryTable.size();
+    header.directoryTable = align(header.fileTable + files.size() * sizeof(CompiledManifestFileEntry));
+    header.childCount = childTable.size();
+    header.childTable = align(header.directoryTable + directoryTable.size() * sizeof(CompiledManifestDirectoryEntry));
+    header.chunkDigestCount = chunkDigests.size();
+    header.chunkDigestTable = align(header.childTable + childTable.size() * sizeof(CompiledManifestChildEntry));
+    header.stringsLength = strings.size();
+    header.stringTable = align(header.chunkDigestTable + chunkDigests.size() * sizeof(Digest));
+
+    // hash indexes let lookups avoid a binary search of string compares
+    PathIndex fileSlots;
+    uint64_t index = 0;
+    for(const auto& f : mFiles)
+        fileSlots.insert(PathIndex::hash(f.first), index++);
+
+    PathIndex directorySlots;
+    index = 0;
+    for(const string& directory : directories)
+        directorySlots.insert(PathIndex::hash(directory), index++);
+
+    header.fileIndexSlotCount = fileSlots.slots().size();
+    header.fileIndexTable = align(header.stringTable + strings.size());
+    header.directoryIndexSlotCount = directorySlots.slots().size();
+    header.directoryIndexTable = align(header.fileIndexTable + fileSlots.slots().size() * sizeof(PathIndexSlot));
+
+    uint64_t position = sizeof(header);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeTable(out, position, header.fileTable, files);
+    writeTable(out, position, header.directoryTable, directoryTable);
+    writeTable(out, position, header.childTable, childTable);
+    writeTable(out, position, header.chunkDigestTable, chunkDigests);
+    writeTable(out, position, header.stringTable, vector<char>(strings.begin(), strings.end()));
+    writeTable(out, position, header.fileIndexTable, fileSlots.slots());
+    writeTable(out, position, header.directoryIndexTable, directorySlots.slots());
+
+    if(!out.good())
+        throw runtime_error("Unable to write compiled manifest");
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef COMPILEDMANIFEST_H
+#define COMPILEDMANIFEST_H
+
+#include "Digest.h"
+#include "PathIndex.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// On disk layout of a compiled manifest, queried in place via mmap.  All
+// offsets are in bytes from the start of the file and every table is 8 byte
+// aligned.  Integers are stored in the byte order of the compiling machine.
+//
+//   header
+//   file table         sorted by path, one entry per listed file
+//   directory table    sorted by path, the root being the empty path
+//   child table        each directory's direct children, sorted by name
+//   chunk digests      raw digests referenced by chunked file entries
+//   strings            path bytes, child names are the tail of their path
+//   file index         PathIndex slots over the file table
+//   directory index    PathIndex slots over the directory table
+
+const char compiledManifestMagic[8] = { 'V', 'F', 'S', 'M', 'A', 'N', 'I', 'F' };
+const uint32_t compiledManifestByteOrder = 0x01020304;
+const uint32_t compiledManifestVersion = 2;
+const size_t compiledManifestDigestLength = 32;
+
+struct CompiledManifestHeader
+{
+    char magic[8];
+    uint32_t byteOrder;
+    uint32_t version;
+    uint32_t digestLength;
+    uint32_t digestAlgorithm;   // IDigestAlgorithm::Id
+    uint64_t fileCount;
+    uint64_t fileTable;
+    uint64_t directoryCount;
+    uint64_t directoryTable;
+    uint64_t childCount;
+    uint64_t childTable;
+    uint64_t chunkDigestCount;
+    uint64_t chunkDigestTable;
+    uint64_t stringsLength;
+    uint64_t stringTable;
+    uint64_t fileIndexSlotCount;
+    uint64_t fileIndexTable;
+    uint64_t directoryIndexSlotCount;
+    uint64_t directoryIndexTable;
+};
+
+struct CompiledManifestFileEntry
+{
+    uint64_t pathOffset;
+    uint32_t pathLength;
+    uint32_t reserved;
+    uint8_t digest[compiledManifestDigestLength];
+    uint64_t chunkSize;
+    uint64_t firstChunkDigest;
+    uint64_t chunkCount;
+};
+
+struct CompiledManifestDirectoryEntry
+{
+    uint64_t pathOffset;
+    uint32_t pathLength;
+    uint32_t reserved;
+    uint64_t firstChild;
+    uint64_t childCount;
+};
+
+struct CompiledManifestChildEntry
+{
+    enum { isDirectoryFlag = 1 };
+
+    uint64_t nameOffset;
+    uint32_t nameLength;
+    uint32_t flags;
+    uint64_t index;         // into the file or directory table
+};
+
+class CompiledManifestWriter
+{
+public:
+    CompiledManifestWriter();
+
+    void setDigestAlgorithm(const uint32_t algorithm);
+    void addFile(const std::string& path, const Digest& digest, const size_t chunkSize, const std::vector<Digest>& chunkDigests);
+    void write(std::ostream& out) const;
+
+private:
+    struct FileRecord
+    {
+        Digest digest;
+        size_t chunkSize;
+        std::vector<Digest> chunkDigests;
+    };
+
+    uint32_t mDigestAlgorithm;
+    std::map<std::string, FileRecord> mFiles;
+};
+
+#endif // COMPILEDMANIFEST_H
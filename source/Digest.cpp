@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "Digest.h"
+#include <openssl/crypto.h>
+
+using namespace std;
+
+namespace {
+
+int hexValue(const char c)
+{
+    if(('0' <= c) && (c <= '9'))
+        return c - '0';
+    else if(('a' <= c) && (c <= 'f'))
+        return c - 'a' + 10;
+    else if(('A' <= c) && (c <= 'F'))
+        return c - 'A' + 10;
+    else
+        return -1;
+}
+
+} // namespace
+
+bool digestFromHex(const string& digestHex, Digest& digest)
+{
+    if((digest.size() * 2) != digestHex.length())
+        return false;
+
+    size_t i;
+    for(i = 0; i < digest.size(); i++)
+    {
+        const int high = hexValue(digestHex[i * 2]);
+        const int low = hexValue(digestHex[i * 2 + 1]);
+        if((high < 0) || (low < 0))
+            return false;
+
+        digest[i] = (high << 4) | low;
+    }
+
+    return true;
+}
+
+string digestToHex(const Digest& digest)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    string digestHex;
+    digestHex.reserve(digest.size() * 2);
+    for(const uint8_t byte : digest)
+    {
+        digestHex += hexDigits[byte >> 4];
+        digestHex += hexDigits[byte & 0x0f];
+    }
+
+    return digestHex;
+}
+
+bool isSameDigest(const uint8_t* a, const uint8_t* b)
+{
+    return (0 == CRYPTO_memcmp(a, b, Digest().size()));
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "DigestAlgorithms.h"
+#include "OpenSSLDigestAlgorithm.h"
+#include "Blake3DigestAlgorithm.h"
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const vector<const IDigestAlgorithm*>& algorithms()
+{
+    // constructed on first use, thread safe since C++11
+    static const OpenSSLDigestAlgorithm sha256(IDigestAlgorithm::sha256, "sha256", "SHA2-256");
+    static const OpenSSLDigestAlgorithm sha512_256(IDigestAlgorithm::sha512_256, "sha512-256", "SHA2-512/256");
+#ifdef VERIFYFS_HAVE_BLAKE3
+    static const Blake3DigestAlgorithm blake3;
+#endif
+
+    static const vector<const IDigestAlgorithm*> all = {
+        &sha256,
+        &sha512_256,
+#ifdef VERIFYFS_HAVE_BLAKE3
+        &blake3,
+#endif
+    };
+
+    return all;
+}
+
+} // namespace
+
+const IDigestAlgorithm* digestAlgorithmNamed(const string& name)
+{
+    for(const IDigestAlgorithm* algorithm : algorithms())
+    {
+        if(name == algorithm->name())
+            return algorithm;
+    }
+
+    return nullptr;
+}
+
+const IDigestAlgorithm* digestAlgorithmWithId(const uint32_t id)
+{
+    for(const IDigestAlgorithm* algorithm : algorithms())
+    {
+        if(id == static_cast<uint32_t>(algorithm->id()))
+            return algorithm;
+    }
+
+    return nullptr;
+}
+
+const IDigestAlgorithm& defaultDigestAlgorithm()
+{
+    return *algorithms().front();
+}
+
+bool isSha256Accelerated()
+{
+    return OpenSSLDigestAlgorithm::isSha256Accelerated();
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "EventTrace.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+// traces are never renumbered, so a thread's ring is never taken for another trace's
+atomic<uint64_t> nextTraceId(1);
+
+void appendEscaped(string& out, const char* text)
+{
+    for(; '\0' != *text; text++)
+    {
+        const unsigned char c = *text;
+        if(('"' == c) || ('\\' == c))
+        {
+            out += '\\';
+            out += c;
+        }
+        else if(c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        }
+        else
+            out += c;
+    }
+}
+
+} // namespace
+
+const size_t EventTrace::eventsPerThread;
+
+// the ring a thread records into, returned to its trace's pool, should the
+// trace remain, when the thread exits or moves on to another trace
+struct EventTrace::ThreadRing
+{
+    ThreadRing() : traceId(0), ring(nullptr) {}
+    ~ThreadRing() { release(); }
+
+    void release()
+    {
+        const shared_ptr<RingPool> rings = pool.lock();
+        if(rings && (nullptr != ring))
+        {
+            lock_guard<mutex> lock(rings->lock);
+            rings->free.push_back(ring);
+        }
+
+        traceId = 0;
+        ring = nullptr;
+        pool.reset();
+    }
+
+    uint64_t traceId;
+    Ring* ring;
+    weak_ptr<RingPool> pool;
+};
+
+EventTrace::Scope::Scope(EventTrace* trace, const char* category, const char* name, const PathView& path) :
+    mTrace(trace),
+    mCategory(category),
+    mName(name),
+    mPath(path),
+    mStart((nullptr != trace) ? chrono::steady_clock::now() : chrono::steady_clock::time_point())
+{
+    // initialiser list only
+}
+
+EventTrace::Scope::~Scope()
+{
+    if(nullptr != mTrace)
+        mTrace->record(mCategory, mName, mPath, mStart, chrono::steady_clock::now());
+}
+
+EventTrace::EventTrace(const string& tracePath) :
+    mId(nextTraceId++),
+    mStart(chrono::steady_clock::now()),
+    mFd(open(tracePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)),
+    mRings(make_shared<RingPool>())
+{
+    if(-1 == mFd)
+        throw runtime_error("Unable to create event trace: " + tracePath);
+}
+
+EventTrace::~EventTrace()
+{
+    write();
+    close(mFd);
+}
+
+void EventTrace::record(const char* category, const char* name, const PathView& path,
+                        const chrono::steady_clock::time_point start, const chrono::steady_clock::time_point end)
+{
+    Ring& ring = threadRing();
+    lock_guard<mutex> lock(ring.lock);
+
+    // the oldest event is overwritten once the ring is full
+    Event& event = ring.events[ring.next];
+    ring.next = (ring.next + 1) % ring.events.size();
+    ring.count = min(ring.count + 1, ring.events.size());
+
+    event.category = category;
+    event.name = name;
+    event.startNs = chrono::duration_cast<chrono::nanoseconds>(start - mStart).count();
+    event.durationNs = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+
+    const size_t length = min(path.length(), sizeof(event.path) - 1);
+    memcpy(event.path, path.data() + path.length() - length, length);
+    event.path[length] = '\0';
+}
+
+void EventTrace::write()
+{
+    string trace = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool isFirst = true;
+
+    lock_guard<mutex> ringsLock(mRings->lock);
+    for(const unique_ptr<Ring>& ring : mRings->rings)
+    {
+        lock_guard<mutex> lock(ring->lock);
+        const size_t oldest = (ring->next + ring->events.size() - ring->count) % ring->events.size();
+
+        size_t i;
+        for(i = 0; i < ring->count; i++)
+        {
+            const Event& event = ring->events[(oldest + i) % ring->events.size()];
+
+            // complete events, timed in microseconds
+            char fields[160];
+            snprintf(fields, sizeof(fields), "\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"path\":\"",
+                     ring->thread, event.startNs / 1000.0, event.durationNs / 1000.0);
+
+            trace += isFirst ? "{\"cat\":\"" : ",\n{\"cat\":\"";
+            trace += event.category;
+            trace += "\",\"name\":\"";
+            trace += event.name;
+            trace += fields;
+            appendEscaped(trace, event.path);
+            trace += "\"}}";
+            isFirst = false;
+        }
+    }
+
+    trace += "\n]}\n";
+
+    // rewritten in place, so the file always holds the latest whole trace
+    if(0 == ftruncate(mFd, 0))
+    {
+        size_t written = 0;
+        while(written < trace.size())
+        {
+            const ssize_t result = pwrite(mFd, trace.data() + written, trace.size() - written, written);
+            if(result <= 0)
+                break;
+
+            written += result;
+        }
+    }
+}
+
+EventTrace::Ring& EventTrace::threadRing()
+{
+    thread_local ThreadRing current;
+    if(mId == current.traceId)
+        return *current.ring;
+
+    // a thread's first event of this trace, recorded in an exited thread's ring if any
+    current.release();
+
+    lock_guard<mutex> lock(mRings->lock);
+    Ring* ring;
+    if(mRings->free.empty())
+    {
+        mRings->rings.push_back(unique_ptr<Ring>(new Ring(mRings->rings.size() + 1)));
+        ring = mRings->rings.back().get();
+    }
+    else
+    {
+        ring = mRings->free.back();
+        mRings->free.pop_back();
+    }
+
+    current.traceId = mId;
+    current.ring = ring;
+    current.pool = mRings;
+    return *ring;
+}
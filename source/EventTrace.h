@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef EVENTTRACE_H
+#define EVENTTRACE_H
+
+#include "PathView.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Timed events of a mount, written to a file in Chrome's trace event format
+// for chrome://tracing or Perfetto.  Each thread records into a ring of its
+// own, keeping its latest eventsPerThread events, so recording takes only
+// that thread's uncontended lock.  A thread's ring outlives it, and is taken up
+// by the next thread to start recording, so a trace holds only as many rings as
+// it ever had threads recording at once.  write() replaces the file with every
+// ring's events so far, and may be called whilst recording continues.
+class EventTrace
+{
+public:
+    static const size_t eventsPerThread = 8192;
+
+    // records its scope as one event of name, with the path it concerns, when
+    // given a trace.  Names are not copied, so must be literals.
+    class Scope
+    {
+    public:
+        Scope(EventTrace* trace, const char* category, const char* name, const PathView& path);
+        ~Scope();
+
+    private:
+        EventTrace* const mTrace;
+        const char* const mCategory;
+        const char* const mName;
+        const PathView mPath;
+        const std::chrono::steady_clock::time_point mStart;
+    };
+
+    EventTrace(const std::string& tracePath);
+    ~EventTrace();
+
+    void record(const char* category, const char* name, const PathView& path,
+                const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end);
+    void write();
+
+private:
+    struct Event
+    {
+        const char* category;
+        const char* name;
+        int64_t startNs;
+        int64_t durationNs;
+
+        // the path's tail, should it not fit
+        char path[88];
+    };
+
+    struct Ring
+    {
+        Ring(const size_t thread) : thread(thread), next(0), count(0), events(eventsPerThread) {}
+
+        std::mutex lock;
+        const size_t thread;
+        size_t next;
+        size_t count;
+        std::vector<Event> events;
+    };
+
+    // shared with the threads recording, which return their rings as they exit
+    struct RingPool
+    {
+        std::mutex lock;
+        std::vector<std::unique_ptr<Ring>> rings;
+        std::vector<Ring*> free;
+    };
+
+    struct ThreadRing;
+
+    Ring& threadRing();
+
+private:
+    const uint64_t mId;
+    const std::chrono::steady_clock::time_point mStart;
+    const int mFd;
+    const std::shared_ptr<RingPool> mRings;
+};
+
+#endif // EVENTTRACE_H
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "FileIdentity.h"
+
+FileIdentity::FileIdentity() :
+    dev(0),
+    ino(0),
+    size(0),
+    mtime(),
+    ctime()
+{
+    // initialiser list only
+}
+
+FileIdentity::FileIdentity(const struct stat& details) :
+    dev(details.st_dev),
+    ino(details.st_ino),
+    size(details.st_size),
+#ifdef __APPLE__
+    mtime(details.st_mtimespec),
+    ctime(details.st_ctimespec)
+#else
+    mtime(details.st_mtim),
+    ctime(details.st_ctim)
+#endif
+{
+    // initialiser list only
+}
+
+bool FileIdentity::operator==(const FileIdentity& other) const
+{
+    return (dev == other.dev)
+            && (ino == other.ino)
+            && (size == other.size)
+            && (mtime.tv_sec == other.mtime.tv_sec)
+            && (mtime.tv_nsec == other.mtime.tv_nsec)
+            && (ctime.tv_sec == other.ctime.tv_sec)
+            && (ctime.tv_nsec == other.ctime.tv_nsec);
+}
+
+bool FileIdentity::operator!=(const FileIdentity& other) const
+{
+    return !(*this == other);
+}
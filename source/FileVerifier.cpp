@@ -30,73 +30,331 @@
  */
 
 #include "FileVerifier.h"
-#include <openssl/sha.h>
-#include <exception>
-#include <libgen.h>
-#include <memory>
-#include <string.h>
+#include "CompiledManifest.h"
+#include "DigestAlgorithms.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
 
 using namespace std;
 
-FileVerifier::FileVerifier(istream& digestsStream)
+namespace {
+
+const string algorithmPrefix = "#algorithm ";
+const string merklePrefix = "#merkle ";
+const string chunkPrefix = "#chunk ";
+const size_t noChunkedFile = static_cast<size_t>(-1);
+
+Digest parseDigest(const string& digestHex, const string& line)
+{
+    Digest digest;
+    if(!digestFromHex(digestHex, digest))
+        throw runtime_error("Malformed digest: " + line);
+
+    return digest;
+}
+
+// shasum separates a digest from its filename with two spaces, or a space and
+// a star in binary mode, returning where the filename starts
+size_t filenameStart(const string& line, const size_t digestStart, const size_t digestEnd)
+{
+    if((string::npos == digestEnd) || (digestEnd + 2 >= line.length()) || (digestEnd == digestStart))
+        throw runtime_error("Malformed digest: " + line);
+
+    return digestEnd + 2;
+}
+
+} // namespace
+
+FileVerifier::FileVerifier(istream& digestsStream) :
+    mAlgorithm(&defaultDigestAlgorithm()),
+    mCurrentChunkedFile(noChunkedFile)
 {
     if(digestsStream.good())
     {
+        saveDirectory(string());
+
         string line;
         while(getline(digestsStream, line))
         {
-            const string hash = line.substr(0, 64);
-            const string filename = line.substr(66);
-            mDigests[filename] = hash;
-            saveUniqueDirectories(filename);
+            if(0 == line.compare(0, algorithmPrefix.length(), algorithmPrefix))
+                parseAlgorithmLine(line);
+            else if(0 == line.compare(0, merklePrefix.length(), merklePrefix))
+                parseMerkleLine(line);
+            else if(0 == line.compare(0, chunkPrefix.length(), chunkPrefix))
+                parseChunkLine(line);
+            else
+            {
+                const size_t digestEnd = line.find(' ');
+                const size_t nameStart = filenameStart(line, 0, digestEnd);
+                const Digest digest = parseDigest(line.substr(0, digestEnd), line);
+                const string filename = line.substr(nameStart);
+
+                FileRecord& file = saveFile(filename);
+                file.hasDigest = true;
+                file.digest = digest;
+            }
         }
+
+        checkRootDigests();
+        saveDirectoryChildren();
     }
     else
         throw runtime_error("Unable to open digests file");
 }
 
-bool FileVerifier::isValidDirectoryPath(const std::string& path) const
+void FileVerifier::compile(ostream& out) const
+{
+    CompiledManifestWriter writer;
+    writer.setDigestAlgorithm(mAlgorithm->id());
+
+    // a whole file digest, when also listed, remains the content digest
+    for(const FileRecord& file : mFiles)
+        writer.addFile(file.path, file.hasDigest ? file.digest : file.rootDigest, file.chunkSize, file.chunkDigests);
+
+    writer.write(out);
+}
+
+bool FileVerifier::isValidDirectoryPath(const PathView& path) const
 {
-    return (mDirectories.end() != mDirectories.find(path));
+    // the root is listable but, as ever, not reported as a listed directory
+    uint64_t index;
+    return !path.empty() && findDirectory(path, index);
 }
 
-bool FileVerifier::isValidFilePath(const std::string& path) const
+bool FileVerifier::isValidFilePath(const PathView& path) const
 {
-    return (mDigests.end() != mDigests.find(path));
+    return (nullptr != findFile(path));
 }
 
-bool FileVerifier::isValidFileBlob(const string& path, const uint8_t* data, const size_t length) const
+bool FileVerifier::isValidFileBlob(const PathView& path, const uint8_t* data, const size_t length) const
 {
-    auto h = mDigests.find(path);
-    if(mDigests.end() == h)
+    const FileRecord* file = findFile(path);
+    if(nullptr == file)
         return false;
 
-    const string expectedDigest = h->second;
+    if(file->hasDigest)
+        return isValidDigest(file->digest, data, length);
 
-    uint8_t digest[SHA256_DIGEST_LENGTH];
-    SHA256(data, length, digest);
+    // files only listed with chunk digests are checked chunk by chunk
+    if(((length + file->chunkSize - 1) / file->chunkSize) != file->chunkDigests.size())
+        return false;
 
-    string digestHex;
-    int i;
-    for(i = 0; i < SHA256_DIGEST_LENGTH; i++)
+    size_t index;
+    for(index = 0; index < file->chunkDigests.size(); index++)
     {
-        char byteBuffer[3];
-        sprintf(byteBuffer, "%02x", digest[i]);
-        digestHex += byteBuffer;
+        const size_t offset = index * file->chunkSize;
+        const size_t chunkLength = min(file->chunkSize, length - offset);
+        if(!isValidDigest(file->chunkDigests[index], data + offset, chunkLength))
+            return false;
     }
 
-    return (digestHex == expectedDigest);
+    return true;
+}
+
+bool FileVerifier::isValidFileDigest(const PathView& path, const Digest& digest) const
+{
+    const FileRecord* file = findFile(path);
+    return (nullptr != file) && file->hasDigest && isSameDigest(digest.data(), file->digest.data());
+}
+
+const IDigestAlgorithm& FileVerifier::digestAlgorithm() const
+{
+    return *mAlgorithm;
+}
+
+bool FileVerifier::contentDigest(const PathView& path, Digest& digest) const
+{
+    const FileRecord* file = findFile(path);
+    if(nullptr == file)
+        return false;
+
+    digest = file->hasDigest ? file->digest : file->rootDigest;
+    return true;
+}
+
+size_t FileVerifier::chunkSize(const PathView& path) const
+{
+    const FileRecord* file = findFile(path);
+    return (nullptr != file) ? file->chunkSize : 0;
+}
+
+size_t FileVerifier::chunkCount(const PathView& path) const
+{
+    const FileRecord* file = findFile(path);
+    return (nullptr != file) ? file->chunkDigests.size() : 0;
+}
+
+bool FileVerifier::isValidFileChunk(const PathView& path, const size_t index, const uint8_t* data, const size_t length) const
+{
+    const FileRecord* file = findFile(path);
+    if(nullptr == file)
+        return false;
+
+    if((index >= file->chunkDigests.size()) || (length > file->chunkSize))
+        return false;
+
+    return isValidDigest(file->chunkDigests[index], data, length);
+}
+
+bool FileVerifier::listDirectory(const PathView& path, vector<DirectoryChild>& children) const
+{
+    uint64_t index;
+    if(!findDirectory(path, index))
+        return false;
+
+    children = mDirectoryChildren[index];
+    return true;
+}
+
+const FileVerifier::FileRecord* FileVerifier::findFile(const PathView& path) const
+{
+    const vector<FileRecord>& files = mFiles;
+    uint64_t index;
+    if(mFileIndex.find(PathIndex::hash(path), [&](uint64_t i) { return path == files[i].path; }, index))
+        return &mFiles[index];
+
+    return nullptr;
+}
+
+bool FileVerifier::findDirectory(const PathView& path, uint64_t& index) const
+{
+    const vector<string>& directories = mDirectories;
+    return mDirectoryIndex.find(PathIndex::hash(path), [&](uint64_t i) { return path == directories[i]; }, index);
+}
+
+FileVerifier::FileRecord& FileVerifier::saveFile(const string& path)
+{
+    // a path listed again updates its existing record
+    const FileRecord* existing = findFile(path);
+    if(nullptr != existing)
+        return mFiles[existing - mFiles.data()];
+
+    FileRecord file;
+    file.path = path;
+    file.hasDigest = false;
+    file.chunkSize = 0;
+
+    mFileIndex.insert(PathIndex::hash(path), mFiles.size());
+    mFiles.push_back(file);
+    saveUniqueDirectories(path);
+
+    return mFiles.back();
+}
+
+void FileVerifier::parseAlgorithmLine(const string& line)
+{
+    // #algorithm <name>, before any digest it applies to
+    if(!mFiles.empty())
+        throw runtime_error("Digest algorithm must precede all digests: " + line);
+
+    mAlgorithm = digestAlgorithmNamed(line.substr(algorithmPrefix.length()));
+    if(nullptr == mAlgorithm)
+        throw runtime_error("Unsupported digest algorithm: " + line);
+}
+
+void FileVerifier::parseMerkleLine(const string& line)
+{
+    // #merkle <chunk size> <root digest>  <filename>
+    const size_t sizeEnd = line.find(' ', merklePrefix.length());
+    if(string::npos == sizeEnd)
+        throw runtime_error("Malformed merkle digest: " + line);
+
+    const size_t rootStart = sizeEnd + 1;
+    const size_t rootEnd = line.find(' ', rootStart);
+    const size_t nameStart = filenameStart(line, rootStart, rootEnd);
+
+    const size_t chunkSize = stoul(line.substr(merklePrefix.length(), sizeEnd - merklePrefix.length()));
+    if(0 == chunkSize)
+        throw runtime_error("Malformed merkle digest: " + line);
+
+    const Digest rootDigest = parseDigest(line.substr(rootStart, rootEnd - rootStart), line);
+
+    FileRecord& file = saveFile(line.substr(nameStart));
+    file.chunkSize = chunkSize;
+    file.rootDigest = rootDigest;
+    file.chunkDigests.clear();
+    mCurrentChunkedFile = &file - mFiles.data();
+}
+
+void FileVerifier::parseChunkLine(const string& line)
+{
+    // #chunk <digest>, belonging to the preceding #merkle line
+    if(noChunkedFile == mCurrentChunkedFile)
+        throw runtime_error("Chunk digest without merkle digest: " + line);
+
+    mFiles[mCurrentChunkedFile].chunkDigests.push_back(parseDigest(line.substr(chunkPrefix.length()), line));
+}
+
+void FileVerifier::checkRootDigests() const
+{
+    // the root digest is the digest of the concatenated binary chunk digests
+    for(const FileRecord& file : mFiles)
+    {
+        if(0 == file.chunkSize)
+            continue;
+
+        // digests are plain byte arrays, so the vector is already concatenated
+        const uint8_t* concatenated = file.chunkDigests.empty() ? nullptr : file.chunkDigests[0].data();
+        if(!isValidDigest(file.rootDigest, concatenated, file.chunkDigests.size() * sizeof(Digest)))
+            throw runtime_error("Merkle root digest mismatch: " + file.path);
+    }
+}
+
+bool FileVerifier::isValidDigest(const Digest& expected, const uint8_t* data, const size_t length) const
+{
+    Digest digest;
+    return mAlgorithm->digest(data, length, digest) && isSameDigest(digest.data(), expected.data());
 }
 
 void FileVerifier::saveUniqueDirectories(const string& path)
 {
-    unique_ptr<char[]> directory = unique_ptr<char[]>(new char[path.length()+1]);
-    strcpy(&directory[0], path.c_str());
+    // walk up from the file's parent, stopping at the first directory already known
+    size_t slash = path.rfind('/');
+    while((string::npos != slash) && (0 != slash))
+    {
+        const PathView directory(path.data(), slash);
+        if(isValidDirectoryPath(directory))
+            break;
+
+        saveDirectory(directory);
+        slash = path.rfind('/', slash - 1);
+    }
+}
+
+void FileVerifier::saveDirectory(const PathView& path)
+{
+    mDirectoryIndex.insert(PathIndex::hash(path), mDirectories.size());
+    mDirectories.push_back(path.str());
+}
+
+void FileVerifier::saveDirectoryChildren()
+{
+    // children view the paths' own storage, so are only taken once parsing has finished
+    mDirectoryChildren.assign(mDirectories.size(), vector<DirectoryChild>());
+
+    auto addChild = [this](const string& path, const bool isDirectory) {
+        const size_t slash = path.rfind('/');
+        const PathView parent(path.data(), (string::npos == slash) ? 0 : slash);
+        const size_t nameStart = (string::npos == slash) ? 0 : slash + 1;
+
+        uint64_t index;
+        if(findDirectory(parent, index))
+            mDirectoryChildren[index].push_back(DirectoryChild(PathView(path.data() + nameStart, path.length() - nameStart), isDirectory));
+    };
+
+    for(const FileRecord& file : mFiles)
+        addChild(file.path, false);
+
+    size_t d;
+    for(d = 1; d < mDirectories.size(); d++)
+        addChild(mDirectories[d], true);
 
-    char* pDirectory = &directory[0];
-    while((NULL != (pDirectory = dirname(pDirectory)))
-          && (*pDirectory != '.'))
+    for(vector<DirectoryChild>& children : mDirectoryChildren)
     {
-        mDirectories.insert(pDirectory);
+        sort(children.begin(), children.end(), [](const DirectoryChild& a, const DirectoryChild& b) {
+            const int order = memcmp(a.name.data(), b.name.data(), min(a.name.length(), b.name.length()));
+            return (0 != order) ? (order < 0) : (a.name.length() < b.name.length());
+        });
     }
 }
@@ -33,26 +33,70 @@
 #define FILEVERIFIER_H
 
 #include "IFileVerifier.h"
-#include <map>
-#include <set>
+#include "PathIndex.h"
+#include <string>
+#include <vector>
 #include <istream>
+#include <ostream>
 
 class FileVerifier : public IFileVerifier
 {
 public:
     FileVerifier(std::istream& digestsStream);
 
+    // writes the manifest in the compiled form read by CompiledFileVerifier
+    void compile(std::ostream& out) const;
+
     // IFileVerifier interface
-    virtual bool isValidDirectoryPath(const std::string& path) const;
-    virtual bool isValidFilePath(const std::string& path) const;
-    virtual bool isValidFileBlob(const std::string& path, const uint8_t* data, const size_t length) const;
+    virtual bool isValidDirectoryPath(const PathView& path) const;
+    virtual bool isValidFilePath(const PathView& path) const;
+    virtual bool isValidFileBlob(const PathView& path, const uint8_t* data, const size_t length) const;
+    virtual bool isValidFileDigest(const PathView& path, const Digest& digest) const;
+    virtual const IDigestAlgorithm& digestAlgorithm() const;
+    virtual bool contentDigest(const PathView& path, Digest& digest) const;
+    virtual size_t chunkSize(const PathView& path) const;
+    virtual size_t chunkCount(const PathView& path) const;
+    virtual bool isValidFileChunk(const PathView& path, const size_t index, const uint8_t* data, const size_t length) const;
+    virtual bool listDirectory(const PathView& path, std::vector<DirectoryChild>& children) const;
 
 private:
+    struct FileRecord
+    {
+        std::string path;
+
+        // whole file digest, when listed
+        bool hasDigest;
+        Digest digest;
+
+        // merkle digests, when listed
+        size_t chunkSize;
+        Digest rootDigest;
+        std::vector<Digest> chunkDigests;
+    };
+
+    const FileRecord* findFile(const PathView& path) const;
+    bool findDirectory(const PathView& path, uint64_t& index) const;
+    FileRecord& saveFile(const std::string& path);
+
+    void parseAlgorithmLine(const std::string& line);
+    void parseMerkleLine(const std::string& line);
+    void parseChunkLine(const std::string& line);
+    void checkRootDigests() const;
+    bool isValidDigest(const Digest& expected, const uint8_t* data, const size_t length) const;
     void saveUniqueDirectories(const std::string& path);
+    void saveDirectory(const PathView& path);
+    void saveDirectoryChildren();
 
 private:
-    std::map<const std::string, std::string> mDigests;
-    std::set<std::string> mDirectories;
+    const IDigestAlgorithm* mAlgorithm;
+    std::vector<FileRecord> mFiles;
+    PathIndex mFileIndex;
+    std::vector<std::string> mDirectories;      // the root first, as the empty path
+    PathIndex mDirectoryIndex;
+    std::vector<std::vector<DirectoryChild>> mDirectoryChildren;
+
+    // index of the file the following #chunk lines belong to
+    size_t mCurrentChunkedFile;
 };
 
 #endif // FILEVERIFIER_H
@@ -30,65 +30,320 @@
  */
 
 #include "FuseFSGlue.h"
+#include "InodeTable.h"
+#include <fuse_lowlevel.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include <strings.h>
+#include <string>
+#include <vector>
+
+using namespace std;
 
 namespace {
 
-inline IFuseFSProvider* getProvider()
+// kernel timeouts, given as fuse's high level attr_timeout and entry_timeout options
+struct Timeouts
+{
+    double attr;
+    double entry;
+};
+
+const struct fuse_opt timeoutOpts[] =
+{
+    { "attr_timeout=%lf", offsetof(Timeouts, attr), 0 },
+    { "entry_timeout=%lf", offsetof(Timeouts, entry), 0 },
+    FUSE_OPT_END
+};
+
+// the state of a mount, the user data of every request
+struct Glue
+{
+    IFuseFSProvider* provider;
+    InodeTable inodes;
+    Timeouts timeouts;
+};
+
+inline Glue& getGlue(fuse_req_t req)
 {
-    struct fuse_context* ctx = fuse_get_context();
-    return static_cast<IFuseFSProvider*>(ctx->private_data);
+    return *static_cast<Glue*>(fuse_req_userdata(req));
 }
 
-int fuseStat(const char* path, struct stat* stbuf)
+// the path of an inode, else replies that it is stale
+bool getPath(fuse_req_t req, fuse_ino_t ino, string& path)
+{
+    if(getGlue(req).inodes.path(ino, path))
+        return true;
+
+    fuse_reply_err(req, ESTALE);
+    return false;
+}
+
+// what fuse's high level API reports for an entry whose number it does not know
+const ino_t unknownInode = 0xffffffff;
+
+// a listing filled into a buffer of the size the kernel asked for
+struct DirectoryBuffer
+{
+    fuse_req_t req;
+    fuse_ino_t ino;
+    vector<char> entries;
+    size_t used;
+};
+
+int fillDirectory(void* buf, const char* name, const struct stat* stbuf, off_t off)
 {
-    return getProvider()->fuseStat(path, stbuf);
+    DirectoryBuffer& directory = *static_cast<DirectoryBuffer*>(buf);
+
+    // entries are numbered as lookup numbers them, never by the provider's own st_ino,
+    // and those the kernel has not looked up as unknown
+    struct stat attributes;
+    bzero(&attributes, sizeof(attributes));
+    if(nullptr != stbuf)
+        attributes.st_mode = stbuf->st_mode;
+
+    const InodeTable& inodes = getGlue(directory.req).inodes;
+    string path;
+    uint64_t inode;
+    if(0 == strcmp(name, "."))
+        attributes.st_ino = directory.ino;
+    else if((0 != strcmp(name, "..")) && inodes.childPath(directory.ino, name, path) && inodes.find(path, inode))
+        attributes.st_ino = inode;
+    else
+        attributes.st_ino = unknownInode;
+
+    const size_t space = directory.entries.size() - directory.used;
+    const size_t entrySize = fuse_add_direntry(directory.req, directory.entries.data() + directory.used, space, name, &attributes, off);
+    if(entrySize > space)
+        return 1;
+
+    directory.used += entrySize;
+    return 0;
 }
 
-int fuseOpendir(const char* path, struct fuse_file_info* fi)
+void fuseInit(void* userdata, struct fuse_conn_info*)
 {
-    return getProvider()->fuseOpendir(path, fi);
+    static_cast<Glue*>(userdata)->provider->fuseInit();
 }
 
-int fuseReaddir(const char* path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi)
+void fuseLookup(fuse_req_t req, fuse_ino_t parent, const char* name)
 {
-    return getProvider()->fuseReaddir(path, buf, filler, offset, fi);
+    Glue& glue = getGlue(req);
+    string path;
+    if(!glue.inodes.childPath(parent, name, path))
+    {
+        fuse_reply_err(req, ESTALE);
+        return;
+    }
+
+    struct fuse_entry_param entry;
+    bzero(&entry, sizeof(entry));
+    const int result = glue.provider->fuseLookup(path.c_str(), &entry.attr);
+    if(0 != result)
+    {
+        fuse_reply_err(req, -result);
+        return;
+    }
+
+    entry.ino = glue.inodes.lookup(path);
+    entry.attr.st_ino = entry.ino;
+    entry.attr_timeout = glue.timeouts.attr;
+    entry.entry_timeout = glue.timeouts.entry;
+
+    // an interrupted lookup was never counted by the kernel
+    if(0 != fuse_reply_entry(req, &entry))
+        glue.inodes.forget(entry.ino, 1);
 }
 
-int fuseReleasedir(const char* path, struct fuse_file_info* fi)
+// tells the provider before the inode's path may be dropped
+void forgetInode(Glue& glue, const fuse_ino_t ino, const uint64_t lookups)
 {
-    return getProvider()->fuseReleasedir(path, fi);
+    string path;
+    if(glue.inodes.path(ino, path))
+        glue.provider->fuseForget(path.c_str(), lookups);
+
+    glue.inodes.forget(ino, lookups);
 }
 
-int fuseOpen(const char* path, struct fuse_file_info* fi)
+void fuseForget(fuse_req_t req, fuse_ino_t ino, unsigned long nlookup)
 {
-    return getProvider()->fuseOpen(path, fi);
+    forgetInode(getGlue(req), ino, nlookup);
+    fuse_reply_none(req);
 }
 
-int fuseRead(const char* path, char* buf, size_t size, off_t offset, struct fuse_file_info* fi)
+void fuseForgetMulti(fuse_req_t req, size_t count, struct fuse_forget_data* forgets)
 {
-    return getProvider()->fuseRead(path, buf, size, offset, fi);
+    Glue& glue = getGlue(req);
+    size_t i;
+    for(i = 0; i < count; i++)
+        forgetInode(glue, forgets[i].ino, forgets[i].nlookup);
+
+    fuse_reply_none(req);
 }
 
-int fuseRelease(const char* path, struct fuse_file_info* fi)
+void fuseStat(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info*)
 {
-    return getProvider()->fuseRelease(path, fi);
+    string path;
+    if(!getPath(req, ino, path))
+        return;
+
+    struct stat attributes;
+    const int result = getGlue(req).provider->fuseStat(path.c_str(), &attributes);
+    if(0 != result)
+    {
+        fuse_reply_err(req, -result);
+        return;
+    }
+
+    attributes.st_ino = ino;
+    fuse_reply_attr(req, &attributes, getGlue(req).timeouts.attr);
+}
+
+void fuseOpendir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi)
+{
+    string path;
+    if(!getPath(req, ino, path))
+        return;
+
+    IFuseFSProvider* provider = getGlue(req).provider;
+    const int result = provider->fuseOpendir(path.c_str(), fi);
+    if(0 != result)
+        fuse_reply_err(req, -result);
+    else if(0 != fuse_reply_open(req, fi))
+        provider->fuseReleasedir(path.c_str(), fi);
+}
+
+void fuseReaddir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info* fi)
+{
+    string path;
+    if(!getPath(req, ino, path))
+        return;
+
+    DirectoryBuffer directory;
+    directory.req = req;
+    directory.ino = ino;
+    directory.entries.resize(size);
+    directory.used = 0;
+
+    const int result = getGlue(req).provider->fuseReaddir(path.c_str(), &directory, fillDirectory, off, fi);
+    if(0 != result)
+        fuse_reply_err(req, -result);
+    else
+        fuse_reply_buf(req, directory.entries.data(), directory.used);
+}
+
+void fuseReleasedir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi)
+{
+    string path;
+    getGlue(req).inodes.path(ino, path);
+    fuse_reply_err(req, -getGlue(req).provider->fuseReleasedir(path.c_str(), fi));
+}
+
+void fuseOpen(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi)
+{
+    string path;
+    if(!getPath(req, ino, path))
+        return;
+
+    IFuseFSProvider* provider = getGlue(req).provider;
+    const int result = provider->fuseOpen(path.c_str(), fi);
+    if(0 != result)
+        fuse_reply_err(req, -result);
+    else if(0 != fuse_reply_open(req, fi))
+        provider->fuseRelease(fi);
+}
+
+void fuseRead(fuse_req_t req, fuse_ino_t, size_t size, off_t off, struct fuse_file_info* fi)
+{
+    // the open file is found through fi->fh, so the inode table is not consulted.
+    // The provider's buffer is replied in place, nothing is allocated or freed here
+    struct fuse_bufvec bufv;
+    bzero(&bufv, sizeof(bufv));
+    bufv.count = 1;
+    const int result = getGlue(req).provider->fuseReadBuf(bufv.buf[0], size, off, fi);
+    if(0 != result)
+        fuse_reply_err(req, -result);
+    else
+        fuse_reply_data(req, &bufv, FUSE_BUF_SPLICE_MOVE);
+}
+
+void fuseRelease(fuse_req_t req, fuse_ino_t, struct fuse_file_info* fi)
+{
+    // released through fi->fh, whether or not the kernel has already forgotten the inode
+    fuse_reply_err(req, -getGlue(req).provider->fuseRelease(fi));
 }
 
 } // namespace
 
 int startFuseFSProvider(int argc, char* argv[], IFuseFSProvider* fuseFSProvider)
 {
-    fuse_operations callbacks;
-    bzero(&callbacks, sizeof(fuse_operations));
+    Glue glue;
+    glue.provider = fuseFSProvider;
+
+    // the high level api's defaults
+    glue.timeouts.attr = 1.0;
+    glue.timeouts.entry = 1.0;
+
+    struct fuse_args args = FUSE_ARGS_INIT(argc, argv);
+    if(-1 == fuse_opt_parse(&args, &glue.timeouts, timeoutOpts, nullptr))
+        return 1;
 
+    fuse_lowlevel_ops callbacks;
+    bzero(&callbacks, sizeof(fuse_lowlevel_ops));
+
+    callbacks.init = fuseInit;
+    callbacks.lookup = fuseLookup;
+    callbacks.forget = fuseForget;
+    callbacks.forget_multi = fuseForgetMulti;
     callbacks.getattr = fuseStat;
     callbacks.opendir = fuseOpendir;
     callbacks.readdir = fuseReaddir;
     callbacks.releasedir = fuseReleasedir;
     callbacks.open = fuseOpen;
     callbacks.read = fuseRead;
-    callbacks.release  = fuseRelease;
+    callbacks.release = fuseRelease;
+
+    // as fuse_main, but with a low level session
+    int result = 1;
+    char* mountpoint = nullptr;
+    int multithreaded = 0;
+    int foreground = 0;
+    struct fuse_chan* channel = nullptr;
+    if((-1 != fuse_parse_cmdline(&args, &mountpoint, &multithreaded, &foreground))
+            && (nullptr != mountpoint)
+            && (nullptr != (channel = fuse_mount(mountpoint, &args))))
+    {
+        struct fuse_session* session = fuse_lowlevel_new(&args, &callbacks, sizeof(callbacks), &glue);
+        if((nullptr != session) && (-1 != fuse_set_signal_handlers(session)))
+        {
+            fuse_session_add_chan(session, channel);
+            if(0 == fuse_daemonize(foreground))
+            {
+                // only inodes the kernel still holds can have anything cached
+                fuseFSProvider->fuseSetInvalidator([&glue, channel](const char* path) {
+                    uint64_t inode;
+                    if(glue.inodes.find(path, inode))
+                        fuse_lowlevel_notify_inval_inode(channel, inode, 0, 0);
+                });
+
+                const int loopResult = multithreaded ? fuse_session_loop_mt(session) : fuse_session_loop(session);
+                result = (0 == loopResult) ? 0 : 1;
+                fuseFSProvider->fuseSetInvalidator(IFuseFSProvider::Invalidator());
+            }
+
+            fuse_remove_signal_handlers(session);
+            fuse_session_remove_chan(channel);
+        }
+
+        if(nullptr != session)
+            fuse_session_destroy(session);
+
+        fuse_unmount(mountpoint, channel);
+    }
 
-    return fuse_main(argc, argv, &callbacks, fuseFSProvider);
+    free(mountpoint);
+    fuse_opt_free_args(&args);
+    return result;
 }
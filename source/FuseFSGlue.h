@@ -34,6 +34,8 @@
 
 #include "IFuseFSProvider.h"
 
+// serves the provider through fuse's low level API, which libfuse 2.9 gives no
+// readdirplus, numbering each path the kernel looks up until it is forgotten
 int startFuseFSProvider(int argc, char* argv[], IFuseFSProvider* fuseFSProvider);
 
 #endif // FUSEFSGLUE_H
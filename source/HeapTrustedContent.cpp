@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "HeapTrustedContent.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+const size_t bufferAlignment = 4096;
+
+} // namespace
+
+HeapTrustedContent::HeapTrustedContent(int fd, size_t length, IReadEngine& engine, IDigestContext* digest) :
+    mLength(length)
+{
+    // left uninitialised, as every byte is about to be read over
+    void* buffer = nullptr;
+    if(0 != posix_memalign(&buffer, bufferAlignment, max<size_t>(length, 1)))
+        throw runtime_error("Unable to allocate untrusted file buffer");
+
+    mBuffer.reset(static_cast<uint8_t*>(buffer));
+
+    uint8_t* data = mBuffer.get();
+    const bool isRead = engine.readFile(fd, data, length, [data, digest](const size_t offset, const size_t blockLength) {
+        return (nullptr == digest) || digest->update(data + offset, blockLength);
+    });
+
+    if(!isRead)
+        throw runtime_error("Unable to read untrusted file");
+}
+
+const uint8_t* HeapTrustedContent::data() const
+{
+    return mBuffer.get();
+}
+
+size_t HeapTrustedContent::size() const
+{
+    return mLength;
+}
+
+bool HeapTrustedContent::verifyRange(const size_t, const size_t)
+{
+    // verified as a whole once loaded
+    return true;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef HEAPTRUSTEDCONTENT_H
+#define HEAPTRUSTEDCONTENT_H
+
+#include "ITrustedContent.h"
+#include "IDigestContext.h"
+#include "IReadEngine.h"
+#include <cstdlib>
+#include <memory>
+
+// Content read from the untrusted file into a private, page aligned heap buffer.
+// Given a digest context the content is hashed block by block as the engine
+// reads it, overlapping reading and hashing.
+class HeapTrustedContent : public ITrustedContent
+{
+public:
+    HeapTrustedContent(int fd, size_t length, IReadEngine& engine, IDigestContext* digest = nullptr);
+
+    // ITrustedContent interface
+    virtual const uint8_t* data() const;
+    virtual size_t size() const;
+    virtual bool verifyRange(const size_t offset, const size_t length);
+
+private:
+    struct FreeBuffer
+    {
+        void operator()(uint8_t* buffer) const { free(buffer); }
+    };
+
+private:
+    std::unique_ptr<uint8_t, FreeBuffer> mBuffer;
+    const size_t mLength;
+};
+
+#endif // HEAPTRUSTEDCONTENT_H
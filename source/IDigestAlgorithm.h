@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef IDIGESTALGORITHM_H
+#define IDIGESTALGORITHM_H
+
+#include "Digest.h"
+#include "IDigestContext.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// A hash producing the 32 byte digests listed in manifests.  Implementations
+// are stateless and shared between threads.
+class IDigestAlgorithm
+{
+public:
+    // stored in compiled manifests, so never renumbered
+    enum Id
+    {
+        sha256 = 0,
+        sha512_256 = 1,
+        blake3 = 2
+    };
+
+    virtual Id id() const = 0;
+
+    // as given in a digests file's #algorithm line
+    virtual const char* name() const = 0;
+
+    // false should the hash itself fail, leaving digest unspecified
+    virtual bool digest(const uint8_t* data, const size_t length, Digest& digest) const = 0;
+
+    // a fresh context for hashing data as it arrives
+    virtual std::unique_ptr<IDigestContext> createContext() const = 0;
+
+    virtual ~IDigestAlgorithm();
+};
+
+#endif // IDIGESTALGORITHM_H
@@ -32,14 +32,48 @@
 #ifndef IFILEVERIFIER_H
 #define IFILEVERIFIER_H
 
+#include "Digest.h"
+#include "IDigestAlgorithm.h"
+#include "PathView.h"
 #include <string>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
+// Paths are relative to the untrusted root, without a leading slash.
 class IFileVerifier
 {
 public:
-    virtual bool isValidDirectoryPath(const std::string& path) const = 0;
-    virtual bool isValidFilePath(const std::string& path) const = 0;
-    virtual bool isValidFileBlob(const std::string& path, const uint8_t* data, const size_t length) const = 0;
+    struct DirectoryChild
+    {
+        DirectoryChild(const PathView& name, const bool isDirectory) : name(name), isDirectory(isDirectory) {}
+
+        // views the verifier's own storage, valid for the verifier's lifetime
+        PathView name;
+        bool isDirectory;
+    };
+
+    virtual bool isValidDirectoryPath(const PathView& path) const = 0;
+    virtual bool isValidFilePath(const PathView& path) const = 0;
+    virtual bool isValidFileBlob(const PathView& path, const uint8_t* data, const size_t length) const = 0;
+
+    // whole file digest computed by the caller, as when hashed whilst read
+    virtual bool isValidFileDigest(const PathView& path, const Digest& digest) const = 0;
+
+    // the algorithm every digest of the manifest was made with
+    virtual const IDigestAlgorithm& digestAlgorithm() const = 0;
+
+    // whole file digest, or merkle root digest for chunked files, false when not listed
+    virtual bool contentDigest(const PathView& path, Digest& digest) const = 0;
+
+    // chunked verification, zero chunk size when path only has a whole file digest
+    virtual size_t chunkSize(const PathView& path) const = 0;
+    virtual size_t chunkCount(const PathView& path) const = 0;
+    virtual bool isValidFileChunk(const PathView& path, const size_t index, const uint8_t* data, const size_t length) const = 0;
+
+    // listed children of a directory, or of the root when path is empty, sorted by name.
+    // false when the directory is not listed.
+    virtual bool listDirectory(const PathView& path, std::vector<DirectoryChild>& children) const = 0;
 
     virtual ~IFileVerifier();
 };
@@ -34,11 +34,30 @@
 
 #define FUSE_USE_VERSION 26
 #include <fuse.h>
+#include <cstdint>
+#include <functional>
 
 class IFuseFSProvider
 {
 public:
-    // fuse handlers
+    // fuse handlers, by path: "/" for the root, "/a/bob.txt" beneath it.  The glue
+    // only maps inode numbers back to paths, so each handler still resolves its path.
+
+    // called once mounted, after any daemonising, so the place to start threads
+    virtual void fuseInit() = 0;
+
+    // drops whatever the kernel has cached of a path's content.  Only to be called
+    // outside of the fuse handlers, on which the kernel may be waiting.
+    typedef std::function<void(const char* path)> Invalidator;
+
+    // given once mounted, before fuseInit, and emptied again before unmounting
+    virtual void fuseSetInvalidator(const Invalidator& invalidate) = 0;
+
+    // a lookup stats a path the kernel then holds until it forgets every lookup of it,
+    // over one or more forgets
+    virtual int fuseLookup(const char* path, struct stat* stbuf) = 0;
+    virtual void fuseForget(const char* path, const uint64_t lookups) = 0;
+
     virtual int fuseStat(const char* path, struct stat* stbuf) = 0;
 
     virtual int fuseOpendir(const char* path, struct fuse_file_info* fi) = 0;
@@ -46,8 +65,15 @@ public:
     virtual int fuseReleasedir (const char* path, struct fuse_file_info* fi) = 0;
 
     virtual int fuseOpen(const char* path, struct fuse_file_info* fi) = 0;
-    virtual int fuseRead(const char* path, char* buf, size_t size, off_t offset, struct fuse_file_info* fi) = 0;
-    virtual int fuseRelease(const char* path, struct fuse_file_info* fi) = 0;
+
+    // reads and releases find their file through fi->fh alone, so the glue need
+    // not resolve the inode to a path for them
+    virtual int fuseRead(char* buf, size_t size, off_t offset, struct fuse_file_info* fi) = 0;
+
+    // as fuseRead, but filling in a buffer of memory, or a file descriptor to splice
+    // from, that is replied without copying and must stay valid until released
+    virtual int fuseReadBuf(struct fuse_buf& buf, size_t size, off_t offset, struct fuse_file_info* fi) = 0;
+    virtual int fuseRelease(struct fuse_file_info* fi) = 0;
 
     virtual ~IFuseFSProvider();
 
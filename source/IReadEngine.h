@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef IREADENGINE_H
+#define IREADENGINE_H
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// The reads of untrusted files verification makes, shared between threads.
+class IReadEngine
+{
+public:
+    struct OpenRequest
+    {
+        OpenRequest(const std::string& path, int directory = AT_FDCWD) : path(path), directory(directory), fd(-1), error(0) {}
+
+        // relative paths are resolved from directory
+        std::string path;
+        int directory;
+
+        // the opened descriptor, for the caller to close, or -1 with error set to the errno
+        int fd;
+        int error;
+        struct stat details;
+    };
+
+    // called with each successive block of a file once it is in the buffer, false abandons the read
+    typedef std::function<bool(const size_t offset, const size_t length)> BlockRead;
+
+    // opens each path read-only and stats the file opened
+    virtual void openFiles(std::vector<OpenRequest>& requests) = 0;
+
+    // reads length bytes from the start of fd into buffer, calling blockRead with
+    // each block in file order.  False when a read fails, the file is shorter than
+    // length or blockRead abandons the read; buffer is no longer written once returned.
+    virtual bool readFile(int fd, uint8_t* buffer, const size_t length, const BlockRead& blockRead) = 0;
+
+    virtual ~IReadEngine();
+};
+
+#endif // IREADENGINE_H
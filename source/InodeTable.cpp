@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "InodeTable.h"
+#include <algorithm>
+
+using namespace std;
+
+const uint64_t InodeTable::rootInode;
+const unsigned InodeTable::shardBits;
+
+namespace {
+
+const string rootPath = "/";
+
+} // namespace
+
+InodeTable::InodeTable()
+{
+    // the root is held apart from the shards, as it is never numbered or forgotten
+}
+
+bool InodeTable::path(const uint64_t inode, string& path) const
+{
+    if(rootInode == inode)
+    {
+        path = rootPath;
+        return true;
+    }
+
+    const Shard& shard = inodeShard(inode);
+    lock_guard<mutex> lock(shard.lock);
+
+    auto n = shard.nodes.find(inode);
+    if(shard.nodes.end() == n)
+        return false;
+
+    path = n->second.path;
+    return true;
+}
+
+bool InodeTable::childPath(const uint64_t parent, const char* name, string& path) const
+{
+    if(!this->path(parent, path))
+        return false;
+
+    if(rootInode != parent)
+        path += '/';
+
+    path += name;
+    return true;
+}
+
+bool InodeTable::find(const string& path, uint64_t& inode) const
+{
+    if(rootPath == path)
+    {
+        inode = rootInode;
+        return true;
+    }
+
+    const Shard& shard = pathShard(path);
+    lock_guard<mutex> lock(shard.lock);
+
+    auto i = shard.inodes.find(path);
+    if(shard.inodes.end() == i)
+        return false;
+
+    inode = i->second;
+    return true;
+}
+
+uint64_t InodeTable::lookup(const string& path)
+{
+    if(rootPath == path)
+        return rootInode;
+
+    Shard& shard = pathShard(path);
+    lock_guard<mutex> lock(shard.lock);
+
+    auto i = shard.inodes.find(path);
+    if(shard.inodes.end() == i)
+    {
+        // numbers are never reused, so a stale number can never name another path,
+        // and carry their shard in their low bits
+        const uint64_t inode = (shard.nextInode++ << shardBits) | (&shard - mShards.data());
+        i = shard.inodes.insert(make_pair(path, inode)).first;
+        Node& node = shard.nodes[inode];
+        node.path = path;
+        node.lookups = 0;
+    }
+
+    shard.nodes[i->second].lookups++;
+    return i->second;
+}
+
+void InodeTable::forget(const uint64_t inode, const uint64_t lookups)
+{
+    if(rootInode == inode)
+        return;
+
+    Shard& shard = inodeShard(inode);
+    lock_guard<mutex> lock(shard.lock);
+
+    auto n = shard.nodes.find(inode);
+    if(shard.nodes.end() == n)
+        return;
+
+    Node& node = n->second;
+    node.lookups -= min(lookups, node.lookups);
+    if(0 == node.lookups)
+    {
+        shard.inodes.erase(node.path);
+        shard.nodes.erase(n);
+    }
+}
+
+size_t InodeTable::size() const
+{
+    size_t count = 1;
+    for(const Shard& shard : mShards)
+    {
+        lock_guard<mutex> lock(shard.lock);
+        count += shard.nodes.size();
+    }
+
+    return count;
+}
+
+InodeTable::Shard& InodeTable::pathShard(const string& path)
+{
+    return mShards[hash<string>()(path) & (mShards.size() - 1)];
+}
+
+const InodeTable::Shard& InodeTable::pathShard(const string& path) const
+{
+    return mShards[hash<string>()(path) & (mShards.size() - 1)];
+}
+
+InodeTable::Shard& InodeTable::inodeShard(const uint64_t inode)
+{
+    return mShards[inode & (mShards.size() - 1)];
+}
+
+const InodeTable::Shard& InodeTable::inodeShard(const uint64_t inode) const
+{
+    return mShards[inode & (mShards.size() - 1)];
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef INODETABLE_H
+#define INODETABLE_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// The inode numbers the kernel knows paths by.  A path is numbered by its
+// first lookup and keeps that number until the kernel has forgotten every
+// lookup of it, after which a later lookup numbers it afresh.  Paths are kept
+// in the provider's form, "/" for the root and "/a/bob.txt" beneath it, so
+// each operation on an inode finds its path without rebuilding it.
+//
+// Paths are spread over shards by their hash, each with a lock of its own, and
+// a path's number carries its shard, so operations on different paths rarely
+// share a lock.
+class InodeTable
+{
+public:
+    // the root is always known, whatever the kernel forgets
+    static const uint64_t rootInode = 1;
+
+    InodeTable();
+
+    // false when the inode is unknown or forgotten
+    bool path(const uint64_t inode, std::string& path) const;
+    bool childPath(const uint64_t parent, const char* name, std::string& path) const;
+
+    // the path's number, without counting a lookup; false when it has none
+    bool find(const std::string& path, uint64_t& inode) const;
+
+    // counts a lookup of the path, numbering it if it has none
+    uint64_t lookup(const std::string& path);
+    void forget(const uint64_t inode, const uint64_t lookups);
+
+    // inodes the kernel currently holds, the root included
+    size_t size() const;
+
+private:
+    static const unsigned shardBits = 4;
+
+    struct Node
+    {
+        std::string path;
+        uint64_t lookups;
+    };
+
+    struct Shard
+    {
+        Shard() : nextInode(1) {}
+
+        mutable std::mutex lock;
+        std::unordered_map<uint64_t, Node> nodes;
+        std::unordered_map<std::string, uint64_t> inodes;
+        uint64_t nextInode;
+    };
+
+    Shard& pathShard(const std::string& path);
+    const Shard& pathShard(const std::string& path) const;
+    Shard& inodeShard(const uint64_t inode);
+    const Shard& inodeShard(const uint64_t inode) const;
+
+private:
+    std::array<Shard, 1 << shardBits> mShards;
+};
+
+#endif // INODETABLE_H
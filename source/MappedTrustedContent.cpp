@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "MappedTrustedContent.h"
+#include <stdexcept>
+#include <sys/mman.h>
+
+using namespace std;
+
+MappedTrustedContent::MappedTrustedContent(int fd, size_t length) :
+    mMapping(nullptr),
+    mLength(length)
+{
+    // mmap refuses zero length mappings, an empty file simply has no pages
+    if(0 != mLength)
+    {
+        mMapping = mmap(nullptr, mLength, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(MAP_FAILED == mMapping)
+            throw runtime_error("Unable to map untrusted file");
+
+        // the verifier walks the whole file front to back
+        madvise(mMapping, mLength, MADV_SEQUENTIAL);
+    }
+}
+
+MappedTrustedContent::~MappedTrustedContent()
+{
+    if(nullptr != mMapping)
+        munmap(mMapping, mLength);
+}
+
+const uint8_t* MappedTrustedContent::data() const
+{
+    return static_cast<const uint8_t*>(mMapping);
+}
+
+size_t MappedTrustedContent::size() const
+{
+    return mLength;
+}
+
+bool MappedTrustedContent::verifyRange(const size_t, const size_t)
+{
+    // verified as a whole once loaded
+    return true;
+}
+
+bool MappedTrustedContent::isRetainable() const
+{
+    // later writes to the untrusted file show through the mapping unverified
+    return false;
+}
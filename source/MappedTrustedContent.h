@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef MAPPEDTRUSTEDCONTENT_H
+#define MAPPEDTRUSTEDCONTENT_H
+
+#include "ITrustedContent.h"
+
+// Content served directly from a read-only MAP_PRIVATE mapping of the untrusted
+// file.  Pages are only as trustworthy as the backing file, so this mode assumes
+// the untrusted tree is not modified while files are held open.
+class MappedTrustedContent : public ITrustedContent
+{
+public:
+    MappedTrustedContent(int fd, size_t length);
+    virtual ~MappedTrustedContent();
+
+    // ITrustedContent interface
+    virtual const uint8_t* data() const;
+    virtual size_t size() const;
+    virtual bool verifyRange(const size_t offset, const size_t length);
+    virtual bool isRetainable() const;
+
+private:
+    MappedTrustedContent(const MappedTrustedContent&) = delete;
+    MappedTrustedContent& operator=(const MappedTrustedContent&) = delete;
+
+private:
+    void* mMapping;
+    const size_t mLength;
+};
+
+#endif // MAPPEDTRUSTEDCONTENT_H
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "OpenSSLDigestAlgorithm.h"
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#elif defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+class OpenSSLDigestContext : public IDigestContext
+{
+public:
+    OpenSSLDigestContext(const EVP_MD* digest) :
+        mContext(EVP_MD_CTX_new())
+    {
+        if((nullptr == mContext) || (1 != EVP_DigestInit_ex(mContext, digest, nullptr)))
+        {
+            EVP_MD_CTX_free(mContext);
+            throw runtime_error("Unable to create digest context");
+        }
+    }
+
+    virtual ~OpenSSLDigestContext()
+    {
+        EVP_MD_CTX_free(mContext);
+    }
+
+    virtual bool update(const uint8_t* data, const size_t length)
+    {
+        return 1 == EVP_DigestUpdate(mContext, data, length);
+    }
+
+    virtual bool finish(Digest& digest)
+    {
+        unsigned int length = 0;
+        return (1 == EVP_DigestFinal_ex(mContext, digest.data(), &length)) && (digest.size() == length);
+    }
+
+private:
+    OpenSSLDigestContext(const OpenSSLDigestContext&) = delete;
+    OpenSSLDigestContext& operator=(const OpenSSLDigestContext&) = delete;
+
+private:
+    EVP_MD_CTX* mContext;
+};
+
+} // namespace
+
+OpenSSLDigestAlgorithm::OpenSSLDigestAlgorithm(const Id id, const char* name, const char* opensslName) :
+    mId(id),
+    mName(name),
+    // fetched once, rather than implicitly on every digest
+    mDigest(EVP_MD_fetch(nullptr, opensslName, nullptr))
+{
+    if(nullptr == mDigest)
+        throw runtime_error(string("Digest algorithm unavailable: ") + name);
+}
+
+OpenSSLDigestAlgorithm::~OpenSSLDigestAlgorithm()
+{
+    EVP_MD_free(mDigest);
+}
+
+IDigestAlgorithm::Id OpenSSLDigestAlgorithm::id() const
+{
+    return mId;
+}
+
+const char* OpenSSLDigestAlgorithm::name() const
+{
+    return mName;
+}
+
+bool OpenSSLDigestAlgorithm::digest(const uint8_t* data, const size_t length, Digest& digest) const
+{
+    return 1 == EVP_Digest(data, length, digest.data(), nullptr, mDigest, nullptr);
+}
+
+unique_ptr<IDigestContext> OpenSSLDigestAlgorithm::createContext() const
+{
+    return unique_ptr<IDigestContext>(new OpenSSLDigestContext(mDigest));
+}
+
+bool OpenSSLDigestAlgorithm::isSha256Accelerated()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    // the CPUID leaf 7 bit OpenSSL's SHA-256 code tests for the SHA extensions,
+    // unless masked off with the OPENSSL_ia32cap environment variable
+    const unsigned int shaExtensions = 1u << 29;
+    unsigned int eax, ebx, ecx, edx;
+    return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (0 != (ebx & shaExtensions));
+#elif defined(__aarch64__)
+    return 0 != (getauxval(AT_HWCAP) & HWCAP_SHA2);
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OPENSSLDIGESTALGORITHM_H
+#define OPENSSLDIGESTALGORITHM_H
+
+#include "IDigestAlgorithm.h"
+#include <openssl/evp.h>
+
+// SHA-2 family digests through OpenSSL, which picks SHA-NI or ARMv8 crypto
+// extension code paths at run time where the CPU has them.
+class OpenSSLDigestAlgorithm : public IDigestAlgorithm
+{
+public:
+    OpenSSLDigestAlgorithm(const Id id, const char* name, const char* opensslName);
+    virtual ~OpenSSLDigestAlgorithm();
+
+    // IDigestAlgorithm interface
+    virtual Id id() const;
+    virtual const char* name() const;
+    virtual bool digest(const uint8_t* data, const size_t length, Digest& digest) const;
+    virtual std::unique_ptr<IDigestContext> createContext() const;
+
+    // whether this CPU's SHA-256 instructions are available to OpenSSL
+    static bool isSha256Accelerated();
+
+private:
+    OpenSSLDigestAlgorithm(const OpenSSLDigestAlgorithm&) = delete;
+    OpenSSLDigestAlgorithm& operator=(const OpenSSLDigestAlgorithm&) = delete;
+
+private:
+    const Id mId;
+    const char* const mName;
+    EVP_MD* mDigest;
+};
+
+#endif // OPENSSLDIGESTALGORITHM_H
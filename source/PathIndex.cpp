@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "PathIndex.h"
+
+using namespace std;
+
+uint64_t PathIndex::hash(const PathView& path)
+{
+    uint64_t value = 14695981039346656037ULL;
+    size_t i;
+    for(i = 0; i < path.length(); i++)
+    {
+        value ^= static_cast<uint8_t>(path.data()[i]);
+        value *= 1099511628211ULL;
+    }
+
+    return value;
+}
+
+PathIndex::PathIndex() :
+    mCount(0)
+{
+    // initialiser list only
+}
+
+void PathIndex::insert(const uint64_t hash, const uint64_t index)
+{
+    // at most half full keeps probe sequences short, even for misses
+    if((mCount + 1) * 2 > mSlots.size())
+        grow();
+
+    const uint64_t mask = mSlots.size() - 1;
+    uint64_t slot = hash & mask;
+    while(0 != mSlots[slot].entry)
+        slot = (slot + 1) & mask;
+
+    mSlots[slot].hash = hash;
+    mSlots[slot].entry = index + 1;
+    mCount++;
+}
+
+const vector<PathIndexSlot>& PathIndex::slots() const
+{
+    return mSlots;
+}
+
+void PathIndex::grow()
+{
+    vector<PathIndexSlot> previous(mSlots.empty() ? 16 : mSlots.size() * 2, PathIndexSlot());
+    previous.swap(mSlots);
+    mCount = 0;
+
+    for(const PathIndexSlot& slot : previous)
+    {
+        if(0 != slot.entry)
+            insert(slot.hash, slot.entry - 1);
+    }
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef PATHINDEX_H
+#define PATHINDEX_H
+
+#include "PathView.h"
+#include <cstdint>
+#include <vector>
+
+// one slot of an open addressed table, laid out identically in memory and
+// within compiled manifests
+struct PathIndexSlot
+{
+    uint64_t hash;
+    uint64_t entry;         // index of the entry plus one, zero when empty
+};
+
+// Open addressed, linearly probed hash index from path to entry index.  The
+// index stores only the full path hash and the entry's position, the caller
+// supplies the comparison against its own entry, so the same probe serves
+// both an in memory index and one mapped from a compiled manifest.
+class PathIndex
+{
+public:
+    // FNV-1a, stable across builds and platforms as compiled manifests store it
+    static uint64_t hash(const PathView& path);
+
+    // slotCount must be zero or a power of two.  matches(i) tests entry i.
+    template<typename Matches>
+    static bool find(const PathIndexSlot* slots, const uint64_t slotCount, const uint64_t hash, Matches matches, uint64_t& index)
+    {
+        if(0 == slotCount)
+            return false;
+
+        // bounded by the table, should it hold no empty slot to end the probe
+        const uint64_t mask = slotCount - 1;
+        uint64_t slot = hash & mask;
+        uint64_t probe;
+        for(probe = 0; (probe < slotCount) && (0 != slots[slot].entry); probe++, slot = (slot + 1) & mask)
+        {
+            if((hash == slots[slot].hash) && matches(slots[slot].entry - 1))
+            {
+                index = slots[slot].entry - 1;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    PathIndex();
+
+    // entries must not be inserted twice
+    void insert(const uint64_t hash, const uint64_t index);
+
+    template<typename Matches>
+    bool find(const uint64_t hash, Matches matches, uint64_t& index) const
+    {
+        return find(mSlots.data(), mSlots.size(), hash, matches, index);
+    }
+
+    const std::vector<PathIndexSlot>& slots() const;
+
+private:
+    void grow();
+
+private:
+    std::vector<PathIndexSlot> mSlots;
+    size_t mCount;
+};
+
+#endif // PATHINDEX_H
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef PATHVIEW_H
+#define PATHVIEW_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+// Non-owning view of a path, letting callers query with whatever they already
+// hold without building a std::string.  The viewed bytes must outlive it.
+class PathView
+{
+public:
+    PathView(const char* path) : mData(path), mLength(strlen(path)) {}
+    PathView(const std::string& path) : mData(path.data()), mLength(path.length()) {}
+    PathView(const char* data, const size_t length) : mData(data), mLength(length) {}
+
+    const char* data() const { return mData; }
+    size_t length() const { return mLength; }
+    bool empty() const { return 0 == mLength; }
+    std::string str() const { return std::string(mData, mLength); }
+
+    bool operator==(const PathView& other) const
+    {
+        return (mLength == other.mLength) && (0 == memcmp(mData, other.mData, mLength));
+    }
+
+private:
+    const char* mData;
+    size_t mLength;
+};
+
+#endif // PATHVIEW_H
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef PROBES_H
+#define PROBES_H
+
+// Static tracepoints for bpftrace, perf and systemtap, under the provider
+// verifyfs.  Each is a nop in the code and a note in the binary, so costs
+// nothing until a tracer attaches; without sys/sdt.h they compile away.
+//
+//   open__entry(path)                  open__return(path, result)
+//   verify__start(path, bytes)         verify__done(path, bytes, isValid)
+//   cache__hit(path)                   cache__miss(path)
+//   read__entry(path, offset, size)    read__return(path, result)
+#ifdef VERIFYFS_HAVE_SDT
+
+#include <sys/sdt.h>
+
+#define VERIFYFS_PROBE1(name, a)           DTRACE_PROBE1(verifyfs, name, a)
+#define VERIFYFS_PROBE2(name, a, b)        DTRACE_PROBE2(verifyfs, name, a, b)
+#define VERIFYFS_PROBE3(name, a, b, c)     DTRACE_PROBE3(verifyfs, name, a, b, c)
+
+#else
+
+#define VERIFYFS_PROBE1(name, a)           do {} while(0)
+#define VERIFYFS_PROBE2(name, a, b)        do {} while(0)
+#define VERIFYFS_PROBE3(name, a, b, c)     do {} while(0)
+
+#endif // VERIFYFS_HAVE_SDT
+
+#endif // PROBES_H
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "SealedTrustedContent.h"
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const int contentSeals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL;
+
+} // namespace
+
+SealedTrustedContent::SealedTrustedContent(int fd, size_t length, IReadEngine& engine, IDigestContext* digest) :
+    mMemfd(memfd_create("verifyfs", MFD_CLOEXEC | MFD_ALLOW_SEALING)),
+    mMapping(nullptr),
+    mLength(length)
+{
+    if(-1 == mMemfd)
+        throw runtime_error("Unable to create sealed file buffer");
+
+    // sized without writing, so its pages are only allocated as they are read into
+    if(0 != ftruncate(mMemfd, mLength))
+    {
+        release();
+        throw runtime_error("Unable to allocate sealed file buffer");
+    }
+
+    // mmap refuses zero length mappings, an empty file simply has no pages
+    if(0 != mLength)
+    {
+        void* writable = mmap(nullptr, mLength, PROT_READ | PROT_WRITE, MAP_SHARED, mMemfd, 0);
+        if(MAP_FAILED == writable)
+        {
+            release();
+            throw runtime_error("Unable to map sealed file buffer");
+        }
+
+        uint8_t* data = static_cast<uint8_t*>(writable);
+        const bool isRead = engine.readFile(fd, data, mLength, [data, digest](const size_t offset, const size_t blockLength) {
+            return (nullptr == digest) || digest->update(data + offset, blockLength);
+        });
+
+        // F_SEAL_WRITE is refused whilst any writable shared mapping remains
+        munmap(writable, mLength);
+        if(!isRead)
+        {
+            release();
+            throw runtime_error("Unable to read untrusted file");
+        }
+    }
+
+    if(0 != fcntl(mMemfd, F_ADD_SEALS, contentSeals))
+    {
+        release();
+        throw runtime_error("Unable to seal file buffer");
+    }
+
+    if(0 != mLength)
+    {
+        mMapping = mmap(nullptr, mLength, PROT_READ, MAP_SHARED, mMemfd, 0);
+        if(MAP_FAILED == mMapping)
+        {
+            mMapping = nullptr;
+            release();
+            throw runtime_error("Unable to map sealed file buffer");
+        }
+    }
+}
+
+SealedTrustedContent::~SealedTrustedContent()
+{
+    release();
+}
+
+void SealedTrustedContent::release()
+{
+    if(nullptr != mMapping)
+        munmap(mMapping, mLength);
+
+    if(-1 != mMemfd)
+        close(mMemfd);
+}
+
+const uint8_t* SealedTrustedContent::data() const
+{
+    return static_cast<const uint8_t*>(mMapping);
+}
+
+size_t SealedTrustedContent::size() const
+{
+    return mLength;
+}
+
+bool SealedTrustedContent::verifyRange(const size_t, const size_t)
+{
+    // verified as a whole once loaded
+    return true;
+}
+
+int SealedTrustedContent::sealedFd() const
+{
+    return mMemfd;
+}
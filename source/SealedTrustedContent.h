@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef SEALEDTRUSTEDCONTENT_H
+#define SEALEDTRUSTEDCONTENT_H
+
+#include "ITrustedContent.h"
+#include "IDigestContext.h"
+#include "IReadEngine.h"
+
+// Content read from the untrusted file into a memfd, hashed block by block as
+// HeapTrustedContent is, then sealed against writes and resizing and served
+// from a read-only mapping.  Its pages are shmem rather than anonymous heap, so
+// the kernel can swap them out under pressure, and the sealed descriptor can be
+// spliced from without any copy through VerifyFS.
+class SealedTrustedContent : public ITrustedContent
+{
+public:
+    SealedTrustedContent(int fd, size_t length, IReadEngine& engine, IDigestContext* digest = nullptr);
+    virtual ~SealedTrustedContent();
+
+    // ITrustedContent interface
+    virtual const uint8_t* data() const;
+    virtual size_t size() const;
+    virtual bool verifyRange(const size_t offset, const size_t length);
+    virtual int sealedFd() const;
+
+private:
+    SealedTrustedContent(const SealedTrustedContent&) = delete;
+    SealedTrustedContent& operator=(const SealedTrustedContent&) = delete;
+
+    void release();
+
+private:
+    int mMemfd;
+    void* mMapping;
+    const size_t mLength;
+};
+
+#endif // SEALEDTRUSTEDCONTENT_H
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "Statistics.h"
+#include <sstream>
+
+using namespace std;
+
+namespace {
+
+// each thread keeps to the shard it was first given
+atomic<size_t> nextShard(0);
+thread_local const size_t threadShard = nextShard++;
+
+size_t bucketOf(uint64_t nanoseconds)
+{
+    size_t bucket = 0;
+    while((0 != nanoseconds) && (bucket < Statistics::bucketCount - 1))
+    {
+        nanoseconds >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+// the upper bound of the bucket holding the percentile, zero when nothing was recorded
+uint64_t percentile(const array<uint64_t, Statistics::bucketCount>& buckets, const uint64_t count, const size_t p)
+{
+    const uint64_t rank = (count * p + 99) / 100;
+    uint64_t seen = 0;
+    size_t b;
+    for(b = 0; b < buckets.size(); b++)
+    {
+        seen += buckets[b];
+        if((0 != seen) && (seen >= rank))
+            return uint64_t(1) << b;
+    }
+
+    return 0;
+}
+
+} // namespace
+
+const size_t Statistics::bucketCount;
+
+Statistics::Timer::Timer(Statistics& statistics, const Operation operation) :
+    mStatistics(statistics),
+    mOperation(operation),
+    mStart(chrono::steady_clock::now())
+{
+    // initialiser list only
+}
+
+Statistics::Timer::~Timer()
+{
+    const chrono::nanoseconds elapsed = chrono::steady_clock::now() - mStart;
+    mStatistics.record(mOperation, elapsed.count());
+}
+
+Statistics::Statistics() :
+    mStart(chrono::steady_clock::now())
+{
+    for(Shard& s : mShards)
+    {
+        for(atomic<uint64_t>& c : s.counters)
+            c = 0;
+
+        for(Histogram& h : s.histograms)
+        {
+            for(atomic<uint64_t>& b : h.buckets)
+                b = 0;
+
+            h.totalNanoseconds = 0;
+        }
+    }
+}
+
+void Statistics::add(const Counter counter, const uint64_t amount)
+{
+    shard().counters[counter].fetch_add(amount, memory_order_relaxed);
+}
+
+void Statistics::record(const Operation operation, const uint64_t nanoseconds)
+{
+    Histogram& histogram = shard().histograms[operation];
+    histogram.buckets[bucketOf(nanoseconds)].fetch_add(1, memory_order_relaxed);
+    histogram.totalNanoseconds.fetch_add(nanoseconds, memory_order_relaxed);
+}
+
+uint64_t Statistics::count(const Counter counter) const
+{
+    uint64_t total = 0;
+    for(const Shard& s : mShards)
+        total += s.counters[counter].load(memory_order_relaxed);
+
+    return total;
+}
+
+uint64_t Statistics::operations(const Operation operation) const
+{
+    uint64_t total = 0;
+    for(const Shard& s : mShards)
+    {
+        for(const atomic<uint64_t>& b : s.histograms[operation].buckets)
+            total += b.load(memory_order_relaxed);
+    }
+
+    return total;
+}
+
+string Statistics::json() const
+{
+    ostringstream out;
+    const chrono::duration<double> uptime = chrono::steady_clock::now() - mStart;
+    out << "{\n  \"uptime_s\": " << uptime.count() << ",\n  \"counters\": {";
+
+    size_t c;
+    for(c = 0; c < counterCount; c++)
+    {
+        const Counter counter = static_cast<Counter>(c);
+        out << ((0 == c) ? "\n" : ",\n") << "    \"" << name(counter) << "\": " << count(counter);
+    }
+
+    out << "\n  },\n  \"latency_ns\": {";
+
+    size_t o;
+    for(o = 0; o < operationCount; o++)
+    {
+        // summed across shards, then reported as count, mean, percentiles and non-empty buckets
+        array<uint64_t, bucketCount> buckets;
+        buckets.fill(0);
+        uint64_t totalNanoseconds = 0;
+        for(const Shard& s : mShards)
+        {
+            const Histogram& h = s.histograms[o];
+            size_t b;
+            for(b = 0; b < bucketCount; b++)
+                buckets[b] += h.buckets[b].load(memory_order_relaxed);
+
+            totalNanoseconds += h.totalNanoseconds.load(memory_order_relaxed);
+        }
+
+        uint64_t count = 0;
+        for(uint64_t b : buckets)
+            count += b;
+
+        out << ((0 == o) ? "\n" : ",\n") << "    \"" << name(static_cast<Operation>(o)) << "\": {"
+            << "\"count\": " << count
+            << ", \"mean\": " << ((0 == count) ? 0 : totalNanoseconds / count)
+            << ", \"p50\": " << percentile(buckets, count, 50)
+            << ", \"p90\": " << percentile(buckets, count, 90)
+            << ", \"p99\": " << percentile(buckets, count, 99)
+            << ", \"buckets\": {";
+
+        bool isFirst = true;
+        size_t b;
+        for(b = 0; b < bucketCount; b++)
+        {
+            if(0 == buckets[b])
+                continue;
+
+            out << (isFirst ? "" : ", ") << "\"" << (uint64_t(1) << b) << "\": " << buckets[b];
+            isFirst = false;
+        }
+
+        out << "}}";
+    }
+
+    out << "\n  }\n}\n";
+    return out.str();
+}
+
+const char* Statistics::name(const Counter counter)
+{
+    static const char* const names[counterCount] =
+    {
+        "opens",
+        "open_failures",
+        "cache_hits",
+        "cache_loads",
+        "preverified_loads",
+        "bytes_loaded",
+        "bytes_hashed",
+        "bytes_served",
+        "verification_failures",
+        "read_failures"
+    };
+
+    return names[counter];
+}
+
+const char* Statistics::name(const Operation operation)
+{
+    static const char* const names[operationCount] =
+    {
+        "lookup",
+        "forget",
+        "getattr",
+        "opendir",
+        "readdir",
+        "releasedir",
+        "open",
+        "read",
+        "read_buf",
+        "release",
+        "load",
+        "verify"
+    };
+
+    return names[operation];
+}
+
+Statistics::Shard& Statistics::shard()
+{
+    return mShards[threadShard % mShards.size()];
+}
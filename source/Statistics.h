@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Counters and latency histograms of a mount, cheap enough to keep always.
+// Each thread updates one of several shards with relaxed atomic adds, so
+// threads rarely share a cache line and never take a lock; reports sum the
+// shards, so may be mid-update but never lose a count.
+class Statistics
+{
+public:
+    enum Counter
+    {
+        opens,
+        openFailures,
+        cacheHits,
+        cacheLoads,
+        preverifiedLoads,
+        bytesLoaded,
+        bytesHashed,
+        bytesServed,
+        verificationFailures,
+        readFailures,
+        counterCount
+    };
+
+    // fuse operations, and the phases of loading verified content
+    enum Operation
+    {
+        lookup,
+        forget,
+        getattr,
+        opendir,
+        readdir,
+        releasedir,
+        open,
+        read,
+        readBuf,
+        release,
+        load,
+        verify,
+        operationCount
+    };
+
+    // bucket n holds latencies below 2^n nanoseconds, the last everything longer
+    static const size_t bucketCount = 36;
+
+    // times its scope as one operation
+    class Timer
+    {
+    public:
+        Timer(Statistics& statistics, const Operation operation);
+        ~Timer();
+
+    private:
+        Statistics& mStatistics;
+        const Operation mOperation;
+        const std::chrono::steady_clock::time_point mStart;
+    };
+
+    Statistics();
+
+    void add(const Counter counter, const uint64_t amount = 1);
+    void record(const Operation operation, const uint64_t nanoseconds);
+
+    uint64_t count(const Counter counter) const;
+    uint64_t operations(const Operation operation) const;
+
+    // every counter and histogram, with percentiles, as a JSON object
+    std::string json() const;
+
+    static const char* name(const Counter counter);
+    static const char* name(const Operation operation);
+
+private:
+    struct Histogram
+    {
+        std::atomic<uint64_t> buckets[bucketCount];
+        std::atomic<uint64_t> totalNanoseconds;
+    };
+
+    struct Shard
+    {
+        std::atomic<uint64_t> counters[counterCount];
+        Histogram histograms[operationCount];
+    };
+
+    Shard& shard();
+
+private:
+    const std::chrono::steady_clock::time_point mStart;
+    std::array<Shard, 16> mShards;
+};
+
+#endif // STATISTICS_H
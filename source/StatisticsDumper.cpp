@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "StatisticsDumper.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+// the signal handler's only means of waking the dumper
+int wakePipe[2] = { -1, -1 };
+
+void onSignal(int)
+{
+    // async-signal-safe, and should the pipe be full a dump is already pending
+    const int savedErrno = errno;
+    const char request = 'd';
+    const ssize_t ignored = write(wakePipe[1], &request, 1);
+    (void) ignored;
+    errno = savedErrno;
+}
+
+} // namespace
+
+StatisticsDumper::StatisticsDumper(const Statistics& statistics, const int signal, ostream& out, const function<void()>& alsoDump) :
+    mStatistics(statistics),
+    mSignal(signal),
+    mOut(out),
+    mAlsoDump(alsoDump)
+{
+    if(-1 != wakePipe[0])
+        throw runtime_error("Statistics are already dumped on a signal");
+
+    if(0 != pipe(wakePipe))
+        throw runtime_error("Unable to create statistics pipe");
+
+    fcntl(wakePipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(wakePipe[1], F_SETFD, FD_CLOEXEC);
+    fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+
+    mThread = thread([this] { run(); });
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(mSignal, &action, &mPrevious);
+}
+
+StatisticsDumper::~StatisticsDumper()
+{
+    sigaction(mSignal, &mPrevious, nullptr);
+
+    // the end of the pipe stops the thread, once it has written any dumps already requested
+    close(wakePipe[1]);
+    mThread.join();
+
+    close(wakePipe[0]);
+    wakePipe[0] = -1;
+    wakePipe[1] = -1;
+}
+
+void StatisticsDumper::run()
+{
+    char request;
+    for(;;)
+    {
+        const ssize_t bytesRead = read(wakePipe[0], &request, 1);
+        if((bytesRead < 0) && (EINTR == errno))
+            continue;
+
+        if(1 != bytesRead)
+            break;
+
+        mOut << mStatistics.json() << flush;
+        if(mAlsoDump)
+            mAlsoDump();
+    }
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef STATISTICSDUMPER_H
+#define STATISTICSDUMPER_H
+
+#include "Statistics.h"
+#include <signal.h>
+#include <functional>
+#include <ostream>
+#include <thread>
+
+// Writes statistics as JSON to a stream whenever the process receives a
+// signal, then calls alsoDump should there be more to write.  The handler
+// only wakes a thread of its own, which does the writing; one dumper may
+// exist at a time.
+class StatisticsDumper
+{
+public:
+    StatisticsDumper(const Statistics& statistics, const int signal, std::ostream& out,
+                     const std::function<void()>& alsoDump = std::function<void()>());
+    ~StatisticsDumper();
+
+private:
+    void run();
+
+private:
+    const Statistics& mStatistics;
+    const int mSignal;
+    std::ostream& mOut;
+    const std::function<void()> mAlsoDump;
+    struct sigaction mPrevious;
+    std::thread mThread;
+};
+
+#endif // STATISTICSDUMPER_H
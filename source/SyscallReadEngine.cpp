@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "SyscallReadEngine.h"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <fcntl.h>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+const size_t SyscallReadEngine::blockLength;
+
+namespace {
+
+// below this a reader thread costs more than the overlap saves
+const size_t readAheadLength = 4 * SyscallReadEngine::blockLength;
+
+} // namespace
+
+void SyscallReadEngine::openFiles(vector<OpenRequest>& requests)
+{
+    for(OpenRequest& request : requests)
+    {
+        request.fd = openat(request.directory, request.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if((-1 != request.fd) && (0 != fstat(request.fd, &request.details)))
+        {
+            request.error = errno;
+            close(request.fd);
+            request.fd = -1;
+        }
+        else if(-1 == request.fd)
+            request.error = errno;
+    }
+}
+
+bool SyscallReadEngine::readFile(int fd, uint8_t* buffer, const size_t length, const BlockRead& blockRead)
+{
+    if(length >= readAheadLength)
+        return readAheadOfBlockRead(fd, buffer, length, blockRead);
+
+    // each block is handed on whilst still in cache from being read
+    size_t offset;
+    for(offset = 0; offset < length; offset += blockLength)
+    {
+        const size_t readLength = min(blockLength, length - offset);
+        if(!readBlock(fd, buffer, offset, readLength) || !blockRead(offset, readLength))
+            return false;
+    }
+
+    return true;
+}
+
+bool SyscallReadEngine::readBlock(int fd, uint8_t* buffer, const size_t offset, const size_t length)
+{
+    // read may return short of length, a file shrinking underneath us ends the read early
+    size_t done = 0;
+    while(done < length)
+    {
+        const ssize_t bytesRead = pread(fd, buffer + offset + done, length - done, offset + done);
+        if((bytesRead < 0) && (EINTR == errno))
+            continue;
+
+        if(bytesRead <= 0)
+            return false;
+
+        done += bytesRead;
+    }
+
+    return true;
+}
+
+bool SyscallReadEngine::readAheadOfBlockRead(int fd, uint8_t* buffer, const size_t length, const BlockRead& blockRead)
+{
+    // the reader fills the buffer ahead of this thread handing it on.  Bytes below
+    // readLength are never written again, so are handed on outside the lock.
+    mutex lock;
+    condition_variable progress;
+    size_t readLength = 0;
+    bool readFailed = false;
+    bool abandoned = false;
+
+    thread reader([&] {
+        size_t offset;
+        for(offset = 0; offset < length; offset += blockLength)
+        {
+            {
+                lock_guard<mutex> guard(lock);
+                if(abandoned)
+                    return;
+            }
+
+            const size_t blockReadLength = min(blockLength, length - offset);
+            const bool isRead = readBlock(fd, buffer, offset, blockReadLength);
+
+            lock_guard<mutex> guard(lock);
+            if(isRead)
+                readLength = offset + blockReadLength;
+            else
+                readFailed = true;
+
+            progress.notify_one();
+            if(!isRead)
+                return;
+        }
+    });
+
+    size_t handedOn = 0;
+    while(handedOn < length)
+    {
+        size_t available;
+        {
+            unique_lock<mutex> guard(lock);
+            progress.wait(guard, [&] { return readFailed || (readLength > handedOn); });
+            if(readFailed)
+                break;
+
+            available = readLength;
+        }
+
+        // in the same blocks as read, whatever the reader's lead
+        for(; handedOn < available; handedOn += min(blockLength, length - handedOn))
+        {
+            if(!blockRead(handedOn, min(blockLength, length - handedOn)))
+            {
+                lock_guard<mutex> guard(lock);
+                abandoned = true;
+                break;
+            }
+        }
+
+        if(abandoned)
+            break;
+    }
+
+    reader.join();
+    return !readFailed && !abandoned;
+}
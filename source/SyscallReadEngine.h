@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef SYSCALLREADENGINE_H
+#define SYSCALLREADENGINE_H
+
+#include "IReadEngine.h"
+
+// Blocking open, fstat and pread, one request at a time.  Large files are read
+// ahead on a second thread so the caller's handling of each block overlaps the
+// reading of the next.
+class SyscallReadEngine : public IReadEngine
+{
+public:
+    // IReadEngine interface
+    virtual void openFiles(std::vector<OpenRequest>& requests);
+    virtual bool readFile(int fd, uint8_t* buffer, const size_t length, const BlockRead& blockRead);
+
+    // blocks read and handed on at a time
+    static const size_t blockLength = 1 << 20;
+
+private:
+    bool readBlock(int fd, uint8_t* buffer, const size_t offset, const size_t length);
+    bool readAheadOfBlockRead(int fd, uint8_t* buffer, const size_t length, const BlockRead& blockRead);
+};
+
+#endif // SYSCALLREADENGINE_H
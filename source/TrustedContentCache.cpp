@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "TrustedContentCache.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+// released content is pruned once the open content table doubles, or reaches this
+const size_t minOpenContentPrune = 64;
+
+} // namespace
+
+TrustedContentCache::Key::Key(const Digest& digest, const size_t chunkSize) :
+    digest(digest),
+    chunkSize(chunkSize)
+{
+    // initialiser list only
+}
+
+bool TrustedContentCache::Key::operator==(const Key& other) const
+{
+    return (chunkSize == other.chunkSize) && (digest == other.digest);
+}
+
+size_t TrustedContentCache::KeyHash::operator()(const Key& key) const
+{
+    // digests are uniformly distributed, so any of their bytes make a good hash
+    size_t value;
+    memcpy(&value, key.digest.data(), sizeof(value));
+    return value ^ key.chunkSize;
+}
+
+TrustedContentCache::TrustedContentCache(size_t capacity) :
+    mCapacity(capacity),
+    mPruneOpenContentAt(minOpenContentPrune),
+    mSize(0)
+{
+    // initialiser list only
+}
+
+shared_ptr<ITrustedContent> TrustedContentCache::find(const Key& key)
+{
+    lock_guard<mutex> lock(mLock);
+    return findLocked(key);
+}
+
+void TrustedContentCache::insert(const Key& key, const shared_ptr<ITrustedContent>& content)
+{
+    // evicted content is released outside of the lock
+    list<shared_ptr<ITrustedContent>> discarded;
+    lock_guard<mutex> lock(mLock);
+    insertLocked(key, content, discarded);
+}
+
+shared_ptr<ITrustedContent> TrustedContentCache::findOrLoad(const Key& key, const Loader& load)
+{
+    promise<shared_ptr<ITrustedContent>> loaded;
+    {
+        unique_lock<mutex> lock(mLock);
+        shared_ptr<ITrustedContent> content = findLocked(key);
+        if(content)
+            return content;
+
+        auto l = mLoading.find(key);
+        if(mLoading.end() != l)
+        {
+            shared_future<shared_ptr<ITrustedContent>> loading = l->second;
+            lock.unlock();
+            return loading.get();
+        }
+
+        mLoading.insert(make_pair(key, loaded.get_future().share()));
+    }
+
+    // loading, typically reading and hashing the whole file, is done unlocked
+    shared_ptr<ITrustedContent> content = load();
+
+    list<shared_ptr<ITrustedContent>> discarded;
+    {
+        lock_guard<mutex> lock(mLock);
+        if(content)
+            insertLocked(key, content, discarded);
+
+        mLoading.erase(key);
+    }
+
+    loaded.set_value(content);
+    return content;
+}
+
+size_t TrustedContentCache::capacity() const
+{
+    return mCapacity;
+}
+
+size_t TrustedContentCache::size() const
+{
+    lock_guard<mutex> lock(mLock);
+    return mSize;
+}
+
+size_t TrustedContentCache::openCount() const
+{
+    lock_guard<mutex> lock(mLock);
+    return mOpenContent.size();
+}
+
+shared_ptr<ITrustedContent> TrustedContentCache::findLocked(const Key& key)
+{
+    auto e = mEntries.find(key);
+    if(mEntries.end() != e)
+    {
+        mRecentlyUsed.splice(mRecentlyUsed.begin(), mRecentlyUsed, e->second.recentlyUsed);
+        return e->second.content;
+    }
+
+    auto o = mOpenContent.find(key);
+    if(mOpenContent.end() == o)
+        return nullptr;
+
+    shared_ptr<ITrustedContent> content = o->second.lock();
+    if(!content)
+        mOpenContent.erase(o);
+
+    return content;
+}
+
+void TrustedContentCache::insertLocked(const Key& key, const shared_ptr<ITrustedContent>& content, list<shared_ptr<ITrustedContent>>& discarded)
+{
+    mOpenContent[key] = content;
+    if(mOpenContent.size() >= mPruneOpenContentAt)
+        pruneOpenContent();
+
+    const size_t length = content->size();
+    if((length > mCapacity) || !content->isRetainable())
+        return;
+
+    auto e = mEntries.find(key);
+    if(mEntries.end() != e)
+        erase(e, discarded);
+
+    while(mSize + length > mCapacity)
+        erase(mEntries.find(mRecentlyUsed.back()), discarded);
+
+    mRecentlyUsed.push_front(key);
+
+    Entry& entry = mEntries[key];
+    entry.content = content;
+    entry.recentlyUsed = mRecentlyUsed.begin();
+    mSize += length;
+}
+
+void TrustedContentCache::erase(Entries::iterator entry, list<shared_ptr<ITrustedContent>>& discarded)
+{
+    mSize -= entry->second.content->size();
+    discarded.push_back(move(entry->second.content));
+    mRecentlyUsed.erase(entry->second.recentlyUsed);
+    mEntries.erase(entry);
+}
+
+void TrustedContentCache::pruneOpenContent()
+{
+    // amortised over the inserts since the last prune, however many remain open
+    auto o = mOpenContent.begin();
+    while(mOpenContent.end() != o)
+    {
+        if(o->second.expired())
+            o = mOpenContent.erase(o);
+        else
+            ++o;
+    }
+
+    mPruneOpenContentAt = max(minOpenContentPrune, 2 * mOpenContent.size());
+}
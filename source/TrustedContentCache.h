@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TRUSTEDCONTENTCACHE_H
+#define TRUSTEDCONTENTCACHE_H
+
+#include "Digest.h"
+#include "ITrustedContent.h"
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Content addressed store of verified content.  Every open of content with
+// the same manifest digest shares a single verified copy, whichever path it
+// was opened by.  Retainable content no longer held open is kept least
+// recently used first within a byte budget, zero retaining nothing.  Concurrent loads of the
+// same content are made once, with every caller sharing the result.
+class TrustedContentCache
+{
+public:
+    struct Key
+    {
+        Key(const Digest& digest, const size_t chunkSize);
+
+        bool operator==(const Key& other) const;
+
+        // whole file digest, or merkle root digest when chunked
+        Digest digest;
+        size_t chunkSize;
+    };
+
+    TrustedContentCache(size_t capacity);
+
+    typedef std::function<std::shared_ptr<ITrustedContent>()> Loader;
+
+    std::shared_ptr<ITrustedContent> find(const Key& key);
+    void insert(const Key& key, const std::shared_ptr<ITrustedContent>& content);
+
+    // finds the content, else loads and inserts it, waiting on any load of it
+    // already under way.  The loader must not throw, and may return null, which
+    // is not inserted.
+    std::shared_ptr<ITrustedContent> findOrLoad(const Key& key, const Loader& load);
+
+    size_t capacity() const;
+    size_t size() const;
+
+    // content tracked as held open, including any released since last pruned
+    size_t openCount() const;
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    typedef std::list<Key> RecentlyUsed;
+
+    struct Entry
+    {
+        std::shared_ptr<ITrustedContent> content;
+        RecentlyUsed::iterator recentlyUsed;
+    };
+
+    typedef std::unordered_map<Key, Entry, KeyHash> Entries;
+
+    std::shared_ptr<ITrustedContent> findLocked(const Key& key);
+    void insertLocked(const Key& key, const std::shared_ptr<ITrustedContent>& content, std::list<std::shared_ptr<ITrustedContent>>& discarded);
+    void erase(Entries::iterator entry, std::list<std::shared_ptr<ITrustedContent>>& discarded);
+    void pruneOpenContent();
+
+private:
+    const size_t mCapacity;
+    mutable std::mutex mLock;
+
+    // all content currently held open, whether retained or not
+    std::unordered_map<Key, std::weak_ptr<ITrustedContent>, KeyHash> mOpenContent;
+    size_t mPruneOpenContentAt;
+
+    // loads under way, waited on by later callers for the same content
+    std::unordered_map<Key, std::shared_future<std::shared_ptr<ITrustedContent>>, KeyHash> mLoading;
+
+    Entries mEntries;
+    RecentlyUsed mRecentlyUsed;
+    size_t mSize;
+};
+
+#endif // TRUSTEDCONTENTCACHE_H
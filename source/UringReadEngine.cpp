@@ -0,0 +1,456 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "UringReadEngine.h"
+
+#ifdef VERIFYFS_HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+
+const size_t UringReadEngine::blockLength;
+const unsigned UringReadEngine::readDepth;
+
+namespace {
+
+// room for a batch of opens, or one file's reads, with their completions
+const unsigned ringEntries = 64;
+
+int ioUringSetup(const unsigned entries, struct io_uring_params* params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, const unsigned toSubmit, const unsigned minComplete, const unsigned flags)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int fd, const unsigned opcode, void* arg, const unsigned argCount)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, argCount));
+}
+
+// The submission and completion rings shared with the kernel.  This thread is
+// the only producer of submissions and the only consumer of completions.
+class Ring
+{
+public:
+    Ring(const unsigned entries) :
+        mFd(-1),
+        mSqRing(MAP_FAILED),
+        mCqRing(MAP_FAILED),
+        mSqes(MAP_FAILED)
+    {
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+
+        mFd = ioUringSetup(entries, &params);
+        if(-1 == mFd)
+            throw runtime_error("Unable to create io_uring");
+
+        mSqRingLength = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        mCqRingLength = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        mSqesLength = params.sq_entries * sizeof(struct io_uring_sqe);
+
+        const bool isSingleMapping = (0 != (params.features & IORING_FEAT_SINGLE_MMAP));
+        if(isSingleMapping)
+            mSqRingLength = mCqRingLength = max(mSqRingLength, mCqRingLength);
+
+        mSqRing = mmap(nullptr, mSqRingLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_SQ_RING);
+        mCqRing = isSingleMapping ? mSqRing
+                                  : mmap(nullptr, mCqRingLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_CQ_RING);
+        mSqes = mmap(nullptr, mSqesLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_SQES);
+        if((MAP_FAILED == mSqRing) || (MAP_FAILED == mCqRing) || (MAP_FAILED == mSqes))
+        {
+            release();
+            throw runtime_error("Unable to map io_uring");
+        }
+
+        uint8_t* sq = static_cast<uint8_t*>(mSqRing);
+        mSqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        mSqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        mSqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        mSqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        mSqEntries = params.sq_entries;
+        mSqLocalTail = *mSqTail;
+
+        uint8_t* cq = static_cast<uint8_t*>(mCqRing);
+        mCqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        mCqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        mCqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        mCqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    ~Ring()
+    {
+        release();
+    }
+
+    bool supports(const unsigned opcode) const
+    {
+        vector<uint8_t> buffer(sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op), 0);
+        struct io_uring_probe* probe = reinterpret_cast<struct io_uring_probe*>(buffer.data());
+        return (0 == ioUringRegister(mFd, IORING_REGISTER_PROBE, probe, 256))
+                && (opcode <= probe->last_op) && (0 != (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED));
+    }
+
+    // a cleared submission entry, queued by the next submit.  The caller keeps
+    // no more in flight than the ring holds.
+    struct io_uring_sqe* nextSubmission()
+    {
+        const unsigned index = mSqLocalTail & mSqMask;
+        mSqArray[index] = index;
+        mSqLocalTail++;
+
+        struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(mSqes) + index;
+        memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    // submits the queued entries, waiting for at least minComplete completions
+    bool submit(const unsigned minComplete)
+    {
+        __atomic_store_n(mSqTail, mSqLocalTail, __ATOMIC_RELEASE);
+
+        for(;;)
+        {
+            const unsigned toSubmit = mSqLocalTail - __atomic_load_n(mSqHead, __ATOMIC_ACQUIRE);
+            if((0 == toSubmit) && (0 == minComplete))
+                return true;
+
+            const int result = ioUringEnter(mFd, toSubmit, minComplete, (0 == minComplete) ? 0 : IORING_ENTER_GETEVENTS);
+            if(result >= 0)
+                return true;
+
+            if((EINTR != errno) && (EAGAIN != errno) && (EBUSY != errno))
+                return false;
+        }
+    }
+
+    bool nextCompletion(struct io_uring_cqe& completion)
+    {
+        const unsigned head = *mCqHead;
+        if(head == __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE))
+            return false;
+
+        completion = mCqes[head & mCqMask];
+        __atomic_store_n(mCqHead, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    unsigned capacity() const
+    {
+        return mSqEntries;
+    }
+
+private:
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    void release()
+    {
+        if(MAP_FAILED != mSqes)
+            munmap(mSqes, mSqesLength);
+
+        if((MAP_FAILED != mCqRing) && (mCqRing != mSqRing))
+            munmap(mCqRing, mCqRingLength);
+
+        if(MAP_FAILED != mSqRing)
+            munmap(mSqRing, mSqRingLength);
+
+        close(mFd);
+    }
+
+private:
+    int mFd;
+    void* mSqRing;
+    size_t mSqRingLength;
+    void* mCqRing;
+    size_t mCqRingLength;
+    void* mSqes;
+    size_t mSqesLength;
+
+    unsigned* mSqHead;
+    unsigned* mSqTail;
+    unsigned mSqMask;
+    unsigned* mSqArray;
+    unsigned mSqEntries;
+    unsigned mSqLocalTail;
+
+    unsigned* mCqHead;
+    unsigned* mCqTail;
+    unsigned mCqMask;
+    struct io_uring_cqe* mCqes;
+};
+
+Ring* threadRing()
+{
+    static thread_local unique_ptr<Ring> ring;
+    static thread_local bool isUnavailable = false;
+
+    if(!ring && !isUnavailable)
+    {
+        try
+        {
+            ring.reset(new Ring(ringEntries));
+        }
+        catch(const runtime_error&)
+        {
+            isUnavailable = true;
+        }
+    }
+
+    return ring.get();
+}
+
+// Once queued, requests point into our buffers until they complete, so giving
+// up on them would leave the kernel writing into memory since freed.  Transient
+// failures are retried by the ring, what remains is misuse of the interface.
+void submitAndWait(Ring& ring, const unsigned minComplete)
+{
+    if(!ring.submit(minComplete))
+    {
+        cerr << "io_uring submission failed with requests queued: " << strerror(errno) << endl;
+        abort();
+    }
+}
+
+void statFromStatx(const struct statx& from, struct stat& to)
+{
+    memset(&to, 0, sizeof(to));
+    to.st_dev = makedev(from.stx_dev_major, from.stx_dev_minor);
+    to.st_ino = from.stx_ino;
+    to.st_mode = from.stx_mode;
+    to.st_nlink = from.stx_nlink;
+    to.st_uid = from.stx_uid;
+    to.st_gid = from.stx_gid;
+    to.st_rdev = makedev(from.stx_rdev_major, from.stx_rdev_minor);
+    to.st_size = from.stx_size;
+    to.st_blksize = from.stx_blksize;
+    to.st_blocks = from.stx_blocks;
+    to.st_atim.tv_sec = from.stx_atime.tv_sec;
+    to.st_atim.tv_nsec = from.stx_atime.tv_nsec;
+    to.st_mtim.tv_sec = from.stx_mtime.tv_sec;
+    to.st_mtim.tv_nsec = from.stx_mtime.tv_nsec;
+    to.st_ctim.tv_sec = from.stx_ctime.tv_sec;
+    to.st_ctim.tv_nsec = from.stx_ctime.tv_nsec;
+}
+
+} // namespace
+
+bool UringReadEngine::isSupported()
+{
+    try
+    {
+        Ring ring(ringEntries);
+        return ring.supports(IORING_OP_OPENAT) && ring.supports(IORING_OP_STATX) && ring.supports(IORING_OP_READ);
+    }
+    catch(const runtime_error&)
+    {
+        return false;
+    }
+}
+
+void UringReadEngine::openFiles(vector<OpenRequest>& requests)
+{
+    Ring* ring = threadRing();
+    if(nullptr == ring)
+    {
+        mFallback.openFiles(requests);
+        return;
+    }
+
+    // a batch of opens, then a batch of stats of the files opened, each a single wait
+    const size_t batchLength = ring->capacity();
+    vector<struct statx> stats(min<size_t>(batchLength, requests.size()));
+
+    size_t first;
+    for(first = 0; first < requests.size(); first += batchLength)
+    {
+        const size_t last = min(first + batchLength, requests.size());
+
+        size_t index;
+        size_t inFlight = 0;
+        for(index = first; index < last; index++)
+        {
+            struct io_uring_sqe* sqe = ring->nextSubmission();
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = requests[index].directory;
+            sqe->addr = reinterpret_cast<uint64_t>(requests[index].path.c_str());
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            sqe->user_data = index;
+            inFlight++;
+        }
+
+        struct io_uring_cqe completion;
+        while(0 != inFlight)
+        {
+            submitAndWait(*ring, 1);
+            while(ring->nextCompletion(completion))
+            {
+                OpenRequest& request = requests[completion.user_data];
+                request.fd = (completion.res >= 0) ? completion.res : -1;
+                request.error = (completion.res >= 0) ? 0 : -completion.res;
+                inFlight--;
+            }
+        }
+
+        // the stat of the file opened, as fstat rather than of whatever the path now names
+        static const char emptyPath[] = "";
+        for(index = first; index < last; index++)
+        {
+            if(-1 == requests[index].fd)
+                continue;
+
+            struct io_uring_sqe* sqe = ring->nextSubmission();
+            sqe->opcode = IORING_OP_STATX;
+            sqe->fd = requests[index].fd;
+            sqe->addr = reinterpret_cast<uint64_t>(emptyPath);
+            sqe->statx_flags = AT_EMPTY_PATH;
+            sqe->len = STATX_BASIC_STATS;
+            sqe->off = reinterpret_cast<uint64_t>(&stats[index - first]);
+            sqe->user_data = index;
+            inFlight++;
+        }
+
+        while(0 != inFlight)
+        {
+            submitAndWait(*ring, 1);
+            while(ring->nextCompletion(completion))
+            {
+                OpenRequest& request = requests[completion.user_data];
+                if(completion.res < 0)
+                {
+                    request.error = -completion.res;
+                    close(request.fd);
+                    request.fd = -1;
+                }
+                else
+                    statFromStatx(stats[completion.user_data - first], request.details);
+
+                inFlight--;
+            }
+        }
+    }
+}
+
+bool UringReadEngine::readFile(int fd, uint8_t* buffer, const size_t length, const BlockRead& blockRead)
+{
+    Ring* ring = threadRing();
+    if(nullptr == ring)
+        return mFallback.readFile(fd, buffer, length, blockRead);
+
+    const size_t blockCount = (length + blockLength - 1) / blockLength;
+    vector<size_t> blockDone(blockCount, 0);
+    vector<size_t> resumes;
+
+    size_t nextToQueue = 0;
+    size_t nextToHandOn = 0;
+    unsigned inFlight = 0;
+    bool failed = false;
+
+    auto blockSize = [&](const size_t block) { return min(blockLength, length - block * blockLength); };
+    auto queueRead = [&](const size_t block) {
+        const size_t offset = block * blockLength + blockDone[block];
+        struct io_uring_sqe* sqe = ring->nextSubmission();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(buffer + offset);
+        sqe->len = blockSize(block) - blockDone[block];
+        sqe->off = offset;
+        sqe->user_data = block;
+        inFlight++;
+    };
+
+    for(;;)
+    {
+        // keep the queue full, resuming short reads first
+        if(!failed)
+        {
+            for(const size_t block : resumes)
+                queueRead(block);
+
+            while((inFlight < readDepth) && (nextToQueue < blockCount))
+                queueRead(nextToQueue++);
+        }
+
+        resumes.clear();
+        submitAndWait(*ring, 0);
+
+        // hand on the blocks read so far whilst later ones are in flight
+        while(!failed && (nextToHandOn < blockCount) && (blockDone[nextToHandOn] == blockSize(nextToHandOn)))
+        {
+            failed = !blockRead(nextToHandOn * blockLength, blockSize(nextToHandOn));
+            nextToHandOn++;
+        }
+
+        if(0 == inFlight)
+            break;
+
+        submitAndWait(*ring, 1);
+
+        struct io_uring_cqe completion;
+        while(ring->nextCompletion(completion))
+        {
+            const size_t block = completion.user_data;
+            inFlight--;
+
+            if(completion.res > 0)
+            {
+                blockDone[block] += completion.res;
+                if(blockDone[block] < blockSize(block))
+                    resumes.push_back(block);
+            }
+            else if((-EINTR == completion.res) || (-EAGAIN == completion.res))
+                resumes.push_back(block);
+            else
+                failed = true;   // an error, or end of file short of length
+        }
+    }
+
+    return !failed && (nextToHandOn == blockCount);
+}
+
+#endif // VERIFYFS_HAVE_IO_URING
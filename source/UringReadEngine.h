@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef URINGREADENGINE_H
+#define URINGREADENGINE_H
+
+#ifdef VERIFYFS_HAVE_IO_URING
+
+#include "IReadEngine.h"
+#include "SyscallReadEngine.h"
+
+// io_uring through the kernel interface directly, without liburing.  Opens and
+// their stats are submitted a batch at a time and each file's reads are kept
+// several blocks deep, so the device sees a queue of requests and each batch
+// costs a few system calls rather than several per file.  Rings are not shared:
+// each thread creates its own on first use, falling back to blocking syscalls
+// should it be unable to.
+class UringReadEngine : public IReadEngine
+{
+public:
+    // whether the kernel, and any seccomp policy, permits the operations used
+    static bool isSupported();
+
+    // IReadEngine interface
+    virtual void openFiles(std::vector<OpenRequest>& requests);
+    virtual bool readFile(int fd, uint8_t* buffer, const size_t length, const BlockRead& blockRead);
+
+    // blocks read and handed on at a time, and the reads kept in flight per file
+    static const size_t blockLength = 256 * 1024;
+    static const unsigned readDepth = 16;
+
+private:
+    SyscallReadEngine mFallback;
+};
+
+#endif // VERIFYFS_HAVE_IO_URING
+
+#endif // URINGREADENGINE_H
@@ -30,149 +30,730 @@
  */
 
 #include "VerifyFS.h"
+#include "ChunkedTrustedContent.h"
+#include "HeapTrustedContent.h"
+#include "MappedTrustedContent.h"
+#include "SealedTrustedContent.h"
+#include "ReadEngines.h"
+#include "Probes.h"
 
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <errno.h>
 #include <unistd.h>
 #include <iostream>
 #include <algorithm>
 #include <string.h>
 #include <stdio.h>
+#include <stdexcept>
 
 using namespace std;
 
-VerifyFS::VerifyFS(const string& untrustedPath, const IFileVerifier& fileVerifier) :
-    mUntrustedPath(untrustedPath),
-    mFileVerifier(fileVerifier)
+namespace {
+
+// paths opened together by a verify_all or prefetch task
+const size_t maxOpenBatch = 32;
+
+// found by lookup, but never listed, so listings remain the manifest's alone
+const char controlDirectory[] = ".verifyfs";
+const char statisticsFile[] = ".verifyfs/stats";
+
+// content VerifyFS produces itself, so has nothing to verify
+class GeneratedContent : public ITrustedContent
+{
+public:
+    GeneratedContent(string&& content) : mContent(move(content)) {}
+
+    virtual const uint8_t* data() const { return reinterpret_cast<const uint8_t*>(mContent.data()); }
+    virtual size_t size() const { return mContent.size(); }
+    virtual bool verifyRange(const size_t, const size_t) { return true; }
+
+private:
+    const string mContent;
+};
+
+} // namespace
+
+VerifyFS::Options::Options() :
+    useMmap(false),
+    cacheSize(0),
+    statTimeout(10.0),
+    prefetchThreads(4),
+    verifyAllThreads(0),
+    memfdThreshold(0),
+    useIoUring(false),
+    spliceRead(false),
+    statisticsSignal(0)
 {
     // initialiser list only
 }
 
-int VerifyFS::fuseStat(const char* path, struct stat* stbuf)
+VerifyFS::VerifyFS(const string& untrustedPath, const IFileVerifier& fileVerifier, const Options& options) :
+    mUntrustedPath(untrustedPath),
+    mUntrustedDirectory(open(untrustedPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)),
+    mFileVerifier(fileVerifier),
+    mOptions(options),
+    mCache(options.cacheSize),
+    mAttributes(options.statTimeout),
+    mVerifyAllRemaining(0),
+    mVerifyAllFailures(0),
+    mReadEngine(createReadEngine(options.useIoUring))
 {
-    // really want a statat
-    string fullpath = mUntrustedPath + path;
-    return stat(fullpath.c_str(), stbuf);
+    // all are opened before fuse daemonises, whilst relative paths still resolve
+    if(-1 == mUntrustedDirectory)
+        throw runtime_error("Unable to open source folder");
+
+    if(!options.recordTracePath.empty())
+        mTraceRecorder.reset(new AccessTraceRecorder(options.recordTracePath));
+
+    if(!options.prefetchTracePath.empty())
+        mPrefetchPaths = readAccessTrace(options.prefetchTracePath);
+
+    if(!options.eventTracePath.empty())
+        mEventTrace.reset(new EventTrace(options.eventTracePath));
+
+    if(!options.statisticsPath.empty())
+    {
+        mStatisticsFile.open(options.statisticsPath, ios::app);
+        if(!mStatisticsFile.good())
+            throw runtime_error("Unable to open statistics file: " + options.statisticsPath);
+    }
 }
 
-int VerifyFS::fuseOpendir(const char* path, struct fuse_file_info* fi)
+VerifyFS::~VerifyFS()
+{
+    // background work may still be opening files within the directory
+    mVerifyAllPool.reset();
+    mPrefetchPool.reset();
+    close(mUntrustedDirectory);
+}
+
+size_t VerifyFS::verifyAllRemaining() const
+{
+    return mVerifyAllRemaining;
+}
+
+size_t VerifyFS::verifyAllFailures() const
+{
+    return mVerifyAllFailures;
+}
+
+void VerifyFS::waitForBackgroundVerification()
+{
+    if(mPrefetchPool)
+        mPrefetchPool->wait();
+
+    if(mVerifyAllPool)
+        mVerifyAllPool->wait();
+}
+
+void VerifyFS::fuseSetInvalidator(const Invalidator& invalidate)
+{
+    lock_guard<mutex> lock(mInvalidatorLock);
+    mInvalidator = invalidate;
+}
+
+const Statistics& VerifyFS::statistics() const
+{
+    return mStatistics;
+}
+
+void VerifyFS::fuseInit()
 {
-    string fullpath = mUntrustedPath + path;
-    DIR* dh = opendir(fullpath.c_str());
-    if(dh)
+    if(0 != mOptions.statisticsSignal)
     {
-        fi->fh = dirfd(dh);
-        fdDir[fi->fh] = dh;
-        return 0;
+        // the event trace, if any, is rewritten with each dump
+        EventTrace* trace = mEventTrace.get();
+        ostream& out = mStatisticsFile.is_open() ? static_cast<ostream&>(mStatisticsFile) : cerr;
+        mStatisticsDumper.reset(new StatisticsDumper(mStatistics, mOptions.statisticsSignal, out, [trace] {
+            if(nullptr != trace)
+                trace->write();
+        }));
+    }
+
+    // mappings are never retained, so would be released as soon as prefetched
+    if(!mPrefetchPaths.empty() && (0 != mOptions.prefetchThreads) && !mOptions.useMmap)
+    {
+        mPrefetchPool.reset(new WorkerPool(mOptions.prefetchThreads));
+        submitInBatches(*mPrefetchPool, mPrefetchPaths, &VerifyFS::prefetchBatch);
+    }
+
+    if(0 != mOptions.verifyAllThreads)
+    {
+        // serving starts straight away, opens of files not yet reached verify as usual
+        vector<string> paths;
+        listFiles(string(), paths);
+
+        mVerifyAllStart = chrono::steady_clock::now();
+        mVerifyAllRemaining = paths.size();
+        mVerifyAllPool.reset(new WorkerPool(mOptions.verifyAllThreads));
+        submitInBatches(*mVerifyAllPool, paths, &VerifyFS::verifyBatch);
     }
-    else
-        return -ENOENT;
 }
 
-int VerifyFS::fuseReaddir(const char* path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi)
+void VerifyFS::submitInBatches(WorkerPool& pool, const vector<string>& paths, void (VerifyFS::*batchTask)(const vector<string>&))
 {
-    auto i = fdDir.find(fi->fh);
-    if(fdDir.end() != i)
+    // files are opened a batch at a time, in batches small enough to keep every thread busy
+    const size_t batchLength = max<size_t>(1, min(maxOpenBatch, paths.size() / max<size_t>(1, pool.threadCount())));
+
+    size_t first;
+    for(first = 0; first < paths.size(); first += batchLength)
     {
-        DIR* fdir = i->second;
-        rewinddir(fdir);
+        const vector<string> batch(paths.begin() + first, paths.begin() + min(first + batchLength, paths.size()));
+        pool.submit([this, batchTask, batch] { (this->*batchTask)(batch); });
+    }
+}
 
-        dirent* pDentry;
-        while(nullptr != (pDentry = readdir(fdir)))
-            filler(buf, pDentry->d_name, NULL, 0);
+void VerifyFS::openBatch(const vector<string>& paths, vector<IReadEngine::OpenRequest>& requests) const
+{
+    EventTrace::Scope event(mEventTrace.get(), "verify", "open_batch", paths.empty() ? PathView("") : PathView(paths.front()));
+    requests.clear();
+    requests.reserve(paths.size());
+    for(const string& path : paths)
+        requests.push_back(IReadEngine::OpenRequest(path, mUntrustedDirectory));
 
-        return 0;
+    mReadEngine->openFiles(requests);
+}
+
+void VerifyFS::listFiles(const string& directory, vector<string>& paths) const
+{
+    vector<IFileVerifier::DirectoryChild> children;
+    mFileVerifier.listDirectory(directory, children);
+
+    for(const IFileVerifier::DirectoryChild& child : children)
+    {
+        const string path = directory.empty() ? child.name.str() : directory + '/' + child.name.str();
+        if(child.isDirectory)
+            listFiles(path, paths);
+        else
+            paths.push_back(path);
     }
-    else
+}
+
+int VerifyFS::fuseLookup(const char* path, struct stat* stbuf)
+{
+    Statistics::Timer timer(mStatistics, Statistics::lookup);
+    EventTrace::Scope event(mEventTrace.get(), "fuse", "lookup", path);
+    return listedAttributes(path, *stbuf);
+}
+
+void VerifyFS::fuseForget(const char* path, const uint64_t)
+{
+    // nothing is held per lookup, so forgets are only counted
+    Statistics::Timer timer(mStatistics, Statistics::forget);
+    EventTrace::Scope event(mEventTrace.get(), "fuse", "forget", path);
+}
+
+int VerifyFS::fuseStat(const char* path, struct stat* stbuf)
+{
+    Statistics::Timer timer(mStatistics, Statistics::getattr);
+    EventTrace::Scope event(mEventTrace.get(), "fuse", "getattr", path);
+    return listedAttributes(path, *stbuf);
+}
+
+int VerifyFS::listedAttributes(const char* path, struct stat& attributes)
+{
+    const char* relativePath = path + 1;
+    if(controlAttributes(relativePath, attributes))
+        return 0;
+
+    if(mAttributes.find(relativePath, attributes))
+        return 0;
+
+    // unlisted paths are hidden, as they are from directory listings
+    if(('\0' != *relativePath) && !mFileVerifier.isValidFilePath(relativePath) && !mFileVerifier.isValidDirectoryPath(relativePath))
+        return -ENOENT;
+
+    return fetchAttributes(relativePath, attributes);
+}
+
+int VerifyFS::fuseOpendir(const char* path, struct fuse_file_info* fi)
+{
+    Statistics::Timer timer(mStatistics, Statistics::opendir);
+    EventTrace::Scope event(mEventTrace.get(), "fuse", "opendir", path);
+
+    // listings come from the manifest alone, the untrusted tree is never read
+    vector<IFileVerifier::DirectoryChild> children;
+    if(0 == strcmp(path + 1, controlDirectory))
+        children.push_back(IFileVerifier::DirectoryChild(statisticsFile + sizeof(controlDirectory), false));
+    else if(!mFileVerifier.listDirectory(path + 1, children))
         return -ENOENT;
+
+    fi->fh = reinterpret_cast<uint64_t>(new OpenDirectory(move(children)));
+    return 0;
 }
 
-int VerifyFS::fuseReleasedir (const char* path, struct fuse_file_info* fi)
+int VerifyFS::fuseReaddir(const char* path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi)
 {
-    auto i = fdDir.find(fi->fh);
-    if(fdDir.end() != i)
+    Statistics::Timer timer(mStatistics, Statistics::readdir);
+    EventTrace::Scope event(mEventTrace.get(), "fuse", "readdir", path);
+    const OpenDirectory* directory = reinterpret_cast<const OpenDirectory*>(fi->fh);
+    if(nullptr == directory)
+        return -ENOENT;
+
+    // entry n is given offset n + 1, so a listing the kernel could not take in one
+    // buffer resumes after the last entry it accepted rather than from the start
+    const vector<IFileVerifier::DirectoryChild>& children = directory->mChildren;
+    const size_t dotEntries = 2;
+    const size_t entryCount = dotEntries + children.size();
+
+    char name[NAME_MAX + 1];
+    size_t entry;
+    for(entry = max<off_t>(offset, 0); entry < entryCount; entry++)
     {
-        closedir(i->second);
-        fdDir.erase(i);
+        struct stat attributes;
+        memset(&attributes, 0, sizeof(attributes));
+
+        if(entry < dotEntries)
+        {
+            strcpy(name, (0 == entry) ? "." : "..");
+            attributes.st_mode = S_IFDIR;
+        }
+        else
+        {
+            // manifest names are not nul terminated
+            const IFileVerifier::DirectoryChild& child = children[entry - dotEntries];
+            if(child.name.length() > NAME_MAX)
+                continue;
+
+            memcpy(name, child.name.data(), child.name.length());
+            name[child.name.length()] = '\0';
+
+            // the kernel takes only the type from a listing, which the manifest
+            // gives without touching the untrusted tree
+            attributes.st_mode = child.isDirectory ? S_IFDIR : S_IFREG;
+        }
+
+        if(0 != filler(buf, name, &attributes, entry + 1))
+            break;
     }
 
     return 0;
 }
 
+int VerifyFS::fuseReleasedir(const char* path, struct fuse_file_info* fi)
+{
+    Statistics::Timer timer(mStatistics, Statistics::releasedir);
+    EventTrace::Scope event(mEventTrace.get(), "fuse", "releasedir", path);
+    delete reinterpret_cast<OpenDirectory*>(fi->fh);
+    fi->fh = 0;
+    return 0;
+}
 
 int VerifyFS::fuseOpen(const char* path, struct fuse_file_info* fi)
 {
-    const string relativePath = path + 1; // +1 is to remove / prepend
+    Statistics::Timer timer(mStatistics, Statistics::open);
+    EventTrace::Scope event(mEventTrace.get(), "fuse", "open", path);
+    VERIFYFS_PROBE1(open__entry, path);
+    const char* relativePath = path + 1; // +1 is to remove / prepend
     const int accessMode = fi->flags & O_ACCMODE;
 
     // only permit readonly
     if(O_RDONLY != accessMode)
+    {
+        VERIFYFS_PROBE2(open__return, path, -EACCES);
         return -EACCES;
+    }
+
+    if(0 == strcmp(relativePath, statisticsFile))
+    {
+        // a fresh report each open, of whatever length, so never cached
+        fi->fh = reinterpret_cast<uint64_t>(new OpenFile(path, make_shared<GeneratedContent>(mStatistics.json())));
+        fi->direct_io = 1;
+        VERIFYFS_PROBE2(open__return, path, 0);
+        return 0;
+    }
+
+    int result = -EACCES;
+    if(mFileVerifier.isValidFilePath(relativePath))
+        result = openAndVerify(path, fi);
 
-    if(! mFileVerifier.isValidFilePath(relativePath))
+    mStatistics.add((0 == result) ? Statistics::opens : Statistics::openFailures);
+    if((0 == result) && mTraceRecorder)
+        mTraceRecorder->record(relativePath);
+
+    VERIFYFS_PROBE2(open__return, path, result);
+    return result;
+}
+
+int VerifyFS::fuseRead(char* buf, size_t size, off_t offset, struct fuse_file_info* fi)
+{
+    Statistics::Timer timer(mStatistics, Statistics::read);
+    OpenFile* file = reinterpret_cast<OpenFile*>(fi->fh);
+    if(nullptr == file)
         return -EACCES;
 
-    return openAndVerify(relativePath);
+    EventTrace::Scope event(mEventTrace.get(), "fuse", "read", file->mPath);
+    VERIFYFS_PROBE3(read__entry, file->mPath.c_str(), offset, size);
+    const uint8_t* data = nullptr;
+    const int result = readOpenFile(*file, size, offset, data);
+    if(result > 0)
+        memcpy(buf, data, result);
+
+    VERIFYFS_PROBE2(read__return, file->mPath.c_str(), result);
+    return result;
 }
 
-int VerifyFS::fuseRead(const char* path, char* buf, size_t size, off_t offset, struct fuse_file_info* fi)
+int VerifyFS::readOpenFile(OpenFile& file, size_t size, off_t offset, const uint8_t*& data)
 {
-    int result = -EACCES;
-    string fullpath = mUntrustedPath + path;
-    auto f = mTrustedFiles.find(fullpath);
-    if(mTrustedFiles.end() != f)
+    int result;
+    ITrustedContent& fileData = *file.mContent;
+    if(offset < 0)
+        result = -EINVAL;
+    else if(static_cast<size_t>(offset) < fileData.size())
     {
-        vector<uint8_t>& fileData = f->second;
-        if(offset < fileData.size())
+        size_t bytesRead = min((size_t)(fileData.size() - offset), (size_t) size);
+        if(fileData.verifyRange(offset, bytesRead))
         {
-            size_t bytesRead = min((size_t)(fileData.size() - offset), (size_t) size);
-            memcpy(buf, fileData.data()+offset, bytesRead);
+            data = fileData.data() + offset;
             result = bytesRead;
         }
+        else
+            result = -EIO;
     }
+    else
+        result = 0;
+
+    if(result < 0)
+        mStatistics.add(Statistics::readFailures);
+    else
+        mStatistics.add(Statistics::bytesServed, result);
 
     return result;
 }
 
-int VerifyFS::fuseRelease(const char* path, struct fuse_file_info* fi)
+int VerifyFS::fuseReadBuf(struct fuse_buf& buf, size_t size, off_t offset, struct fuse_file_info* fi)
+{
+    Statistics::Timer timer(mStatistics, Statistics::readBuf);
+    OpenFile* file = reinterpret_cast<OpenFile*>(fi->fh);
+    if(nullptr == file)
+        return -EACCES;
+
+    EventTrace::Scope event(mEventTrace.get(), "fuse", "read_buf", file->mPath);
+    VERIFYFS_PROBE3(read__entry, file->mPath.c_str(), offset, size);
+
+    memset(&buf, 0, sizeof(buf));
+    buf.fd = -1;
+
+    if(-1 != file->mContent->sealedFd())
+    {
+        // sealed content can never change, so fuse may splice it without copying
+        const off_t length = file->mContent->size();
+        buf.size = (offset < length) ? min<size_t>(size, length - offset) : 0;
+        mStatistics.add(Statistics::bytesServed, buf.size);
+        buf.flags = static_cast<enum fuse_buf_flags>(FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK);
+        buf.fd = file->mContent->sealedFd();
+        buf.pos = offset;
+    }
+    else
+    {
+        // verified memory is replied in place, held by the open, which the kernel
+        // never releases whilst a read of it is outstanding
+        const uint8_t* data = nullptr;
+        const int result = readOpenFile(*file, size, offset, data);
+        if(result < 0)
+        {
+            VERIFYFS_PROBE2(read__return, file->mPath.c_str(), result);
+            return result;
+        }
+
+        buf.size = result;
+        buf.mem = const_cast<uint8_t*>(data);
+    }
+
+    VERIFYFS_PROBE2(read__return, file->mPath.c_str(), static_cast<int>(buf.size));
+    return 0;
+}
+
+int VerifyFS::fuseRelease(struct fuse_file_info* fi)
+{
+    Statistics::Timer timer(mStatistics, Statistics::release);
+
+    // declared before the event, so the path it labels outlives it
+    unique_ptr<OpenFile> file(reinterpret_cast<OpenFile*>(fi->fh));
+    fi->fh = 0;
+    if(!file)
+        return 0;
+
+    EventTrace::Scope event(mEventTrace.get(), "fuse", "release", file->mPath);
+    return 0;
+}
+
+bool VerifyFS::controlAttributes(const char* path, struct stat& attributes) const
+{
+    const bool isDirectory = (0 == strcmp(path, controlDirectory));
+    if(!isDirectory && (0 != strcmp(path, statisticsFile)))
+        return false;
+
+    // owned by whoever mounted, readable by all.  The report's size is only
+    // known once opened, which reads it directly.
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.st_mode = isDirectory ? (S_IFDIR | 0555) : (S_IFREG | 0444);
+    attributes.st_nlink = isDirectory ? 2 : 1;
+    attributes.st_uid = getuid();
+    attributes.st_gid = getgid();
+    return true;
+}
+
+int VerifyFS::fetchAttributes(const PathView& path, struct stat& attributes)
 {
-    string fullpath = mUntrustedPath + path;
-    mTrustedFiles.erase(fullpath);
+    if(mAttributes.find(path, attributes))
+        return 0;
+
+    // the root's manifest path is empty
+    const string relativePath = path.empty() ? string(".") : path.str();
+    if(0 != fstatat(mUntrustedDirectory, relativePath.c_str(), &attributes, 0))
+        return -errno;
+
+    mAttributes.insert(path, attributes);
     return 0;
 }
 
-int VerifyFS::openAndVerify(const string& path)
+int VerifyFS::openAndVerify(const char* path, struct fuse_file_info* fi)
 {
-    string fullpath = mUntrustedPath + '/' + path;
+    const char* relativePath = path + 1; // +1 is to remove / prepend
+    shared_ptr<ITrustedContent> content;
+    const int result = verifiedContent(relativePath, [this, relativePath] { return loadUntrusted(relativePath); }, content);
+    if(0 == result)
+    {
+        // each open holds its own reference, independent of other opens
+        const bool isRetainable = content->isRetainable();
+        fi->fh = reinterpret_cast<uint64_t>(new OpenFile(path, move(content)));
+
+        // the manifest is fixed for the mount, so every page the kernel has cached
+        // for this path holds the same verified content and can be kept.  Content
+        // that reads through to the untrusted file, as a mapping does, cannot be.
+        fi->keep_cache = isRetainable ? 1 : 0;
+    }
+
+    return result;
+}
+
+int VerifyFS::verifiedContent(const char* path, const TrustedContentCache::Loader& loader, shared_ptr<ITrustedContent>& content)
+{
+    Digest digest;
+    if(!mFileVerifier.contentDigest(path, digest))
+        return -EACCES;
 
-    int result = -ENOENT;
-    int fh = open(fullpath.c_str(), O_RDONLY);
-    if(-1 != fh)
+    // identical content shares one verified copy, however many paths list it,
+    // and an open racing a prefetch of the same content waits for it
+    const TrustedContentCache::Key key(digest, mFileVerifier.chunkSize(path));
+    bool isLoaded = false;
+    EventTrace::Scope event(mEventTrace.get(), "verify", "cache", path);
+    content = mCache.findOrLoad(key, [&isLoaded, &loader] { isLoaded = true; return loader(); });
+    mStatistics.add(isLoaded ? Statistics::cacheLoads : Statistics::cacheHits);
+    if(isLoaded)
+        VERIFYFS_PROBE1(cache__miss, path);
+    else
+        VERIFYFS_PROBE1(cache__hit, path);
+
+    return content ? 0 : -ENOENT;
+}
+
+shared_ptr<ITrustedContent> VerifyFS::loadUntrusted(const char* path)
+{
+    int fh;
+    {
+        EventTrace::Scope event(mEventTrace.get(), "verify", "openat", path);
+        fh = openat(mUntrustedDirectory, path, O_RDONLY | O_CLOEXEC);
+    }
+
+    if(-1 == fh)
+        return nullptr;
+
+    bool isStated;
+    struct stat details;
     {
-        struct stat details;
-        fstat(fh, &details);
+        EventTrace::Scope event(mEventTrace.get(), "verify", "fstat", path);
+        isStated = (0 == fstat(fh, &details));
+    }
 
-        vector<uint8_t> buffer;
-        buffer.resize(details.st_size);
+    shared_ptr<ITrustedContent> content;
+    if(isStated)
+        content = loadOpened(path, fh, details);
 
-        const off_t bytesRead = read(fh, buffer.data(), details.st_size);
-        close(fh);
+    // a mapping remains valid after its descriptor is closed
+    close(fh);
+    return content;
+}
 
-        if(bytesRead == details.st_size)
+shared_ptr<ITrustedContent> VerifyFS::loadOpened(const char* path, int fh, const struct stat& details)
+{
+    // the open's own fstat is as fresh as any getattr
+    mAttributes.insert(path, details);
+
+    const bool isPreverified = (0 != mOptions.verifyAllThreads) && mVerifiedFiles.contains(path, FileIdentity(details));
+    return loadAndVerify(path, fh, details, isPreverified);
+}
+
+void VerifyFS::prefetchBatch(const vector<string>& paths)
+{
+    // a trace may predate the manifest, so is checked like any other open
+    vector<string> listed;
+    for(const string& path : paths)
+    {
+        if(mFileVerifier.isValidFilePath(path))
+            listed.push_back(path);
+    }
+
+    vector<IReadEngine::OpenRequest> requests;
+    openBatch(listed, requests);
+
+    size_t i;
+    for(i = 0; i < listed.size(); i++)
+    {
+        const char* path = listed[i].c_str();
+        const IReadEngine::OpenRequest& opened = requests[i];
+        if(-1 == opened.fd)
+            continue;
+
+        // chunked content verifies as it is read, so is read through now
+        EventTrace::Scope event(mEventTrace.get(), "verify", "prefetch", path);
+        shared_ptr<ITrustedContent> content;
+        if((0 == verifiedContent(path, [this, path, &opened] { return loadOpened(path, opened.fd, opened.details); }, content))
+                && (0 != content->size()))
+            content->verifyRange(0, content->size());
+
+        close(opened.fd);
+    }
+}
+
+void VerifyFS::verifyBatch(const vector<string>& paths)
+{
+    vector<IReadEngine::OpenRequest> requests;
+    openBatch(paths, requests);
+
+    size_t i;
+    for(i = 0; i < paths.size(); i++)
+    {
+        verifyInFull(paths[i], requests[i]);
+        if(-1 != requests[i].fd)
+            close(requests[i].fd);
+    }
+}
+
+void VerifyFS::verifyInFull(const string& path, const IReadEngine::OpenRequest& opened)
+{
+    EventTrace::Scope event(mEventTrace.get(), "verify", "verify_all", path);
+    bool isVerified = false;
+
+    // every listed path's own file is read, even when its content is already cached
+    Digest digest;
+    if((-1 != opened.fd) && mFileVerifier.contentDigest(path, digest))
+    {
+        // chunked content verifies as it is read, so is read through now
+        shared_ptr<ITrustedContent> content = loadAndVerify(path, opened.fd, opened.details, false);
+        if(content && ((0 == content->size()) || content->verifyRange(0, content->size())))
         {
-            bool isGood = mFileVerifier.isValidFileBlob(path, buffer.data(), buffer.size());
-            if(isGood)
-            {
-                mTrustedFiles[fullpath] = buffer;
-                result = 0;
-            }
+            mVerifiedFiles.insert(path, FileIdentity(opened.details));
+            mCache.insert(TrustedContentCache::Key(digest, mFileVerifier.chunkSize(path)), content);
+            isVerified = true;
+        }
+    }
+    else
+        cerr << "Unable to open:  " << mUntrustedPath << '/' << path << endl;
+
+    if(!isVerified)
+    {
+        // nothing more is served from the kernel's cache of a file that no longer verifies
+        mVerifyAllFailures++;
+        invalidate(path);
+    }
+
+    if(1 == mVerifyAllRemaining--)
+    {
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - mVerifyAllStart;
+        cerr << "verify_all: " << mVerifiedFiles.size() << " files verified, " << mVerifyAllFailures
+             << " failed, in " << elapsed.count() << "s" << endl;
+    }
+}
+
+void VerifyFS::invalidate(const string& path)
+{
+    // called with the lock held, so the glue cannot empty it mid call
+    lock_guard<mutex> lock(mInvalidatorLock);
+    if(mInvalidator)
+        mInvalidator(("/" + path).c_str());
+}
+
+shared_ptr<ITrustedContent> VerifyFS::loadAndVerify(const string& path, int fh, const struct stat& details, const bool isPreverified)
+{
+    // chunked files are verified lazily as they are read
+    const bool isChunked = (0 != mFileVerifier.chunkSize(path));
+
+    // heap content is hashed as it is read, unless preverified
+    unique_ptr<IDigestContext> digest;
+    VERIFYFS_PROBE2(verify__start, path.c_str(), details.st_size);
+
+    shared_ptr<ITrustedContent> content;
+    try
+    {
+        // heap content is read and hashed together, so its load includes hashing
+        Statistics::Timer timer(mStatistics, Statistics::load);
+        EventTrace::Scope event(mEventTrace.get(), "verify", "load", path);
+        if(isChunked)
+            content.reset(new ChunkedTrustedContent(fh, details.st_size, mFileVerifier, path));
+        else if(mOptions.useMmap)
+            content.reset(new MappedTrustedContent(fh, details.st_size));
+        else
+        {
+            if(!isPreverified)
+                digest = mFileVerifier.digestAlgorithm().createContext();
+
+            const bool isSealed = mOptions.spliceRead
+                    || ((0 != mOptions.memfdThreshold) && (static_cast<size_t>(details.st_size) >= mOptions.memfdThreshold));
+            if(isSealed)
+                content.reset(new SealedTrustedContent(fh, details.st_size, *mReadEngine, digest.get()));
             else
-                cerr << "Failed validation:  " << fullpath << endl;
+                content.reset(new HeapTrustedContent(fh, details.st_size, *mReadEngine, digest.get()));
+        }
+    }
+    catch(const exception& e)
+    {
+        cerr << e.what() << ":  " << mUntrustedPath << '/' << path << endl;
+    }
+
+    if(content)
+        mStatistics.add(Statistics::bytesLoaded, content->size());
+
+    Statistics::Timer timer(mStatistics, Statistics::verify);
+    EventTrace::Scope event(mEventTrace.get(), "verify", "verify", path);
+    bool isValid = isChunked;
+    if(content && digest)
+    {
+        Digest actual;
+        isValid = digest->finish(actual) && mFileVerifier.isValidFileDigest(path, actual);
+        mStatistics.add(Statistics::bytesHashed, content->size());
+    }
+    else if(content && !isChunked)
+    {
+        // preverified content is only trusted if the file did not change whilst being read.
+        // Chunked content reads lazily, long after this check, so is always hashed.
+        if(isPreverified)
+        {
+            struct stat after;
+            isValid = (0 == fstat(fh, &after)) && (FileIdentity(details) == FileIdentity(after));
+            if(isValid)
+                mStatistics.add(Statistics::preverifiedLoads);
+        }
 
+        if(!isValid)
+        {
+            isValid = mFileVerifier.isValidFileBlob(path, content->data(), content->size());
+            mStatistics.add(Statistics::bytesHashed, content->size());
         }
     }
 
-    return result;
+    if(content && !isValid)
+    {
+        cerr << "Failed validation:  " << mUntrustedPath << '/' << path << endl;
+        mStatistics.add(Statistics::verificationFailures);
+        content.reset();
+    }
+
+    VERIFYFS_PROBE3(verify__done, path.c_str(), details.st_size, static_cast<int>(isValid));
+    return content;
 }
 
 
@@ -34,36 +34,163 @@
 
 #include "IFuseFSProvider.h"
 #include "IFileVerifier.h"
-#include <dirent.h>
+#include "ITrustedContent.h"
+#include "TrustedContentCache.h"
+#include "AttributeCache.h"
+#include "AccessTrace.h"
+#include "WorkerPool.h"
+#include "VerifiedFileTable.h"
+#include "IReadEngine.h"
+#include "Statistics.h"
+#include "StatisticsDumper.h"
+#include "EventTrace.h"
 
+#include <atomic>
+#include <chrono>
+#include <fstream>
 #include <string>
-#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 class VerifyFS : public IFuseFSProvider
 {
 public:
-    VerifyFS(const std::string& untrustedPath, const IFileVerifier& fileVerifier);
+    struct Options
+    {
+        Options();
+
+        // serve verified files from a read-only mapping rather than a heap copy
+        bool useMmap;
+
+        // bytes of verified content retained between opens, zero retains none
+        size_t cacheSize;
+
+        // seconds listed paths' attributes are served before the backing tree is stat'd again
+        double statTimeout;
+
+        // when set, the paths opened are recorded to this access trace
+        std::string recordTracePath;
+
+        // when set, the paths of this access trace are verified ahead of their
+        // opens by prefetchThreads threads, retained as cacheSize allows
+        std::string prefetchTracePath;
+        size_t prefetchThreads;
+
+        // when non-zero, every listed file is verified at mount by this many
+        // threads, and later opens of a file unchanged since skip hashing it
+        size_t verifyAllThreads;
+
+        // when non-zero, verified copies of files of at least this many bytes are
+        // held in a sealed memfd, swappable and spliced from, rather than the heap
+        size_t memfdThreshold;
+
+        // read through io_uring where available, rather than blocking syscalls
+        bool useIoUring;
+
+        // every verified copy of a whole file is held in a sealed memfd, as with a
+        // memfdThreshold of one byte, for fuse to splice rather than copy
+        bool spliceRead;
+
+        // when non-zero, statistics are written on this signal once mounted, appended
+        // to statisticsPath when set and otherwise to stderr
+        int statisticsSignal;
+        std::string statisticsPath;
+
+        // when set, fuse operations and verification phases are traced to this
+        // file, written when unmounted and with each statistics signal
+        std::string eventTracePath;
+    };
+
+    VerifyFS(const std::string& untrustedPath, const IFileVerifier& fileVerifier, const Options& options = Options());
+    ~VerifyFS();
+
+    // files verify_all has yet to verify, and has failed to
+    size_t verifyAllRemaining() const;
+    size_t verifyAllFailures() const;
+
+    // blocks until prefetch and verify_all have been through all their files
+    void waitForBackgroundVerification();
+
+    // also readable as JSON from the mount's .verifyfs/stats
+    const Statistics& statistics() const;
 
     // IFuseFSProvider interface
+    virtual void fuseInit();
+    virtual void fuseSetInvalidator(const Invalidator& invalidate);
+    virtual int fuseLookup(const char* path, struct stat* stbuf);
+    virtual void fuseForget(const char* path, const uint64_t lookups);
     virtual int fuseStat(const char* path, struct stat* stbuf);
     virtual int fuseOpendir(const char* path, struct fuse_file_info* fi);
     virtual int fuseReaddir(const char* path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi);
     virtual int fuseReleasedir(const char* path, struct fuse_file_info* fi);
     virtual int fuseOpen(const char* path, struct fuse_file_info* fi);
-    virtual int fuseRead(const char* path, char* buf, size_t size, off_t offset, struct fuse_file_info* fi);
-    virtual int fuseRelease(const char* path, struct fuse_file_info* fi);
+    virtual int fuseRead(char* buf, size_t size, off_t offset, struct fuse_file_info* fi);
+    virtual int fuseReadBuf(struct fuse_buf& buf, size_t size, off_t offset, struct fuse_file_info* fi);
+    virtual int fuseRelease(struct fuse_file_info* fi);
 
 private:
-    int openAndVerify(const std::string& path);
+    struct OpenDirectory
+    {
+        OpenDirectory(std::vector<IFileVerifier::DirectoryChild>&& children) : mChildren(std::move(children)) {}
+
+        const std::vector<IFileVerifier::DirectoryChild> mChildren;
+    };
+
+    // the path is kept only to label the open's reads in traces and probes
+    struct OpenFile
+    {
+        OpenFile(const char* path, std::shared_ptr<ITrustedContent> content) : mPath(path), mContent(std::move(content)) {}
+
+        const std::string mPath;
+        const std::shared_ptr<ITrustedContent> mContent;
+    };
+
+    bool controlAttributes(const char* path, struct stat& attributes) const;
+    int listedAttributes(const char* path, struct stat& attributes);
+    int fetchAttributes(const PathView& path, struct stat& attributes);
+    int readOpenFile(OpenFile& file, size_t size, off_t offset, const uint8_t*& data);
+    int openAndVerify(const char* path, struct fuse_file_info* fi);
+    int verifiedContent(const char* path, const TrustedContentCache::Loader& loader, std::shared_ptr<ITrustedContent>& content);
+    std::shared_ptr<ITrustedContent> loadUntrusted(const char* path);
+    std::shared_ptr<ITrustedContent> loadOpened(const char* path, int fh, const struct stat& details);
+    void submitInBatches(WorkerPool& pool, const std::vector<std::string>& paths, void (VerifyFS::*batchTask)(const std::vector<std::string>&));
+    void openBatch(const std::vector<std::string>& paths, std::vector<IReadEngine::OpenRequest>& requests) const;
+    void prefetchBatch(const std::vector<std::string>& paths);
+    void listFiles(const std::string& directory, std::vector<std::string>& paths) const;
+    void verifyBatch(const std::vector<std::string>& paths);
+    void verifyInFull(const std::string& path, const IReadEngine::OpenRequest& opened);
+    std::shared_ptr<ITrustedContent> loadAndVerify(const std::string& path, int fh, const struct stat& details, const bool isPreverified);
+    void invalidate(const std::string& path);
 
 private:
     const std::string mUntrustedPath;
+
+    // untrusted files are opened relative to this, by their manifest paths
+    const int mUntrustedDirectory;
     const IFileVerifier& mFileVerifier;
-    std::map<std::string, std::vector<uint8_t>> mTrustedFiles;
+    const Options mOptions;
+    TrustedContentCache mCache;
+    AttributeCache mAttributes;
+    std::unique_ptr<AccessTraceRecorder> mTraceRecorder;
+    std::vector<std::string> mPrefetchPaths;
+    VerifiedFileTable mVerifiedFiles;
+    std::chrono::steady_clock::time_point mVerifyAllStart;
+    std::atomic<size_t> mVerifyAllRemaining;
+    std::atomic<size_t> mVerifyAllFailures;
+    std::unique_ptr<IReadEngine> mReadEngine;
+    Statistics mStatistics;
+    std::ofstream mStatisticsFile;
+    std::unique_ptr<EventTrace> mEventTrace;
+    std::unique_ptr<StatisticsDumper> mStatisticsDumper;
 
-    std::map<int, DIR*> fdDir;
+    // set by the glue whilst mounted, and called from background work
+    std::mutex mInvalidatorLock;
+    Invalidator mInvalidator;
 
+    // last, so background work stops before anything it uses is destroyed
+    std::unique_ptr<WorkerPool> mPrefetchPool;
+    std::unique_ptr<WorkerPool> mVerifyAllPool;
 };
 
 #endif // VERIFYFS_H
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "WorkerPool.h"
+
+using namespace std;
+
+WorkerPool::WorkerPool(const size_t threadCount) :
+    mRunning(0),
+    mStopping(false)
+{
+    size_t i;
+    for(i = 0; i < threadCount; i++)
+        mThreads.push_back(thread(&WorkerPool::run, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        lock_guard<mutex> lock(mLock);
+        mStopping = true;
+        mTasks.clear();
+    }
+
+    mQueued.notify_all();
+    for(thread& t : mThreads)
+        t.join();
+}
+
+void WorkerPool::submit(Task task)
+{
+    {
+        lock_guard<mutex> lock(mLock);
+        mTasks.push_back(move(task));
+    }
+
+    mQueued.notify_one();
+}
+
+void WorkerPool::wait()
+{
+    unique_lock<mutex> lock(mLock);
+    mIdle.wait(lock, [this] { return mTasks.empty() && (0 == mRunning); });
+}
+
+size_t WorkerPool::threadCount() const
+{
+    return mThreads.size();
+}
+
+void WorkerPool::run()
+{
+    unique_lock<mutex> lock(mLock);
+    while(true)
+    {
+        mQueued.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+        if(mStopping)
+            return;
+
+        Task task = move(mTasks.front());
+        mTasks.pop_front();
+        mRunning++;
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        mRunning--;
+        if(mTasks.empty() && (0 == mRunning))
+            mIdle.notify_all();
+    }
+}
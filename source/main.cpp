@@ -31,31 +31,231 @@
 
 #include <iostream>
 #include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <cctype>
+#include <memory>
+#include <signal.h>
 
 #include "VerifyFS.h"
 #include "FileVerifier.h"
+#include "CompiledFileVerifier.h"
+#include "DigestAlgorithms.h"
+#include "ReadEngines.h"
 #include "FuseFSGlue.h"
 
 using namespace std;
 
+namespace {
+
+struct VerifyFSArgs
+{
+    string sourceMountPath;
+    string fileHashesPath;
+    VerifyFS::Options options;
+};
+
+enum
+{
+    KEY_MMAP,
+    KEY_CACHE_SIZE,
+    KEY_STAT_TIMEOUT,
+    KEY_RECORD_TRACE,
+    KEY_PREFETCH_TRACE,
+    KEY_PREFETCH_THREADS,
+    KEY_VERIFY_ALL,
+    KEY_IO_URING,
+    KEY_SPLICE_READ,
+    KEY_EVENT_TRACE,
+    KEY_STATS_FILE,
+    KEY_MEMFD_THRESHOLD
+};
+
+const struct fuse_opt verifyFSOpts[] =
+{
+    FUSE_OPT_KEY("mmap", KEY_MMAP),
+    FUSE_OPT_KEY("cache_size=", KEY_CACHE_SIZE),
+    FUSE_OPT_KEY("stat_timeout=", KEY_STAT_TIMEOUT),
+    FUSE_OPT_KEY("record_trace=", KEY_RECORD_TRACE),
+    FUSE_OPT_KEY("prefetch_trace=", KEY_PREFETCH_TRACE),
+    FUSE_OPT_KEY("prefetch_threads=", KEY_PREFETCH_THREADS),
+    FUSE_OPT_KEY("verify_all=", KEY_VERIFY_ALL),
+    FUSE_OPT_KEY("io_uring", KEY_IO_URING),
+    FUSE_OPT_KEY("splice_read", KEY_SPLICE_READ),
+    FUSE_OPT_KEY("event_trace=", KEY_EVENT_TRACE),
+    FUSE_OPT_KEY("stats_file=", KEY_STATS_FILE),
+    FUSE_OPT_KEY("memfd_threshold=", KEY_MEMFD_THRESHOLD),
+    FUSE_OPT_END
+};
+
+// byte counts may carry a k, m or g suffix
+bool parseSize(const char* value, size_t& size)
+{
+    // strtoull would take a sign, and wrap "-1" to the largest size
+    if(!isdigit(static_cast<unsigned char>(*value)))
+        return false;
+
+    char* suffix = nullptr;
+    errno = 0;
+    const unsigned long long count = strtoull(value, &suffix, 10);
+    if((suffix == value) || (ERANGE == errno))
+        return false;
+
+    unsigned shift;
+    switch(*suffix)
+    {
+    case '\0':      shift = 0; break;
+    case 'k':
+    case 'K':       shift = 10; break;
+    case 'm':
+    case 'M':       shift = 20; break;
+    case 'g':
+    case 'G':       shift = 30; break;
+    default:        return false;
+    }
+
+    // refused rather than wrapped to a smaller size
+    if(count > (SIZE_MAX >> shift))
+        return false;
+
+    size = static_cast<size_t>(count) << shift;
+    return true;
+}
+
+// well beyond any useful parallelism, yet far short of exhausting threads
+const size_t maxThreadCount = 1024;
+
+// strtoul would take a sign, and wrap "-1" to the largest count
+bool parseThreadCount(const char* value, size_t& count)
+{
+    if(!isdigit(static_cast<unsigned char>(*value)))
+        return false;
+
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long parsed = strtoul(value, &end, 10);
+    if(('\0' != *end) || (ERANGE == errno) || (parsed > maxThreadCount))
+        return false;
+
+    count = parsed;
+    return true;
+}
+
+const char* optionValue(const char* arg)
+{
+    return strchr(arg, '=') + 1;
+}
+
+} // namespace
+
 int verifyFSAdditionalArgs(void* data, const char* arg, int key, struct fuse_args* outargs)
 {
-    string& sourceMountPath = static_cast<string*>(data)[0];
-    string& fileHashesPath = static_cast<string*>(data)[1];
+    VerifyFSArgs& verifyFSArgs = *static_cast<VerifyFSArgs*>(data);
+
+    if(KEY_MMAP == key)
+    {
+        verifyFSArgs.options.useMmap = true;
+        return 0;
+    }
+    else if(KEY_CACHE_SIZE == key)
+    {
+        if(!parseSize(optionValue(arg), verifyFSArgs.options.cacheSize))
+        {
+            cerr << "Invalid cache_size: " << arg << endl;
+            return -1;
+        }
+
+        return 0;
+    }
+    else if(KEY_MEMFD_THRESHOLD == key)
+    {
+        if(!parseSize(optionValue(arg), verifyFSArgs.options.memfdThreshold))
+        {
+            cerr << "Invalid memfd_threshold: " << arg << endl;
+            return -1;
+        }
+
+        return 0;
+    }
+    else if(KEY_STAT_TIMEOUT == key)
+    {
+        char* end = nullptr;
+        verifyFSArgs.options.statTimeout = strtod(optionValue(arg), &end);
+        if(('\0' != *end) || (verifyFSArgs.options.statTimeout < 0))
+        {
+            cerr << "Invalid stat_timeout: " << arg << endl;
+            return -1;
+        }
 
-    if(FUSE_OPT_KEY_NONOPT != key)
+        return 0;
+    }
+    else if(KEY_RECORD_TRACE == key)
+    {
+        verifyFSArgs.options.recordTracePath = optionValue(arg);
+        return 0;
+    }
+    else if(KEY_EVENT_TRACE == key)
+    {
+        verifyFSArgs.options.eventTracePath = optionValue(arg);
+        return 0;
+    }
+    else if(KEY_STATS_FILE == key)
+    {
+        verifyFSArgs.options.statisticsPath = optionValue(arg);
+        return 0;
+    }
+    else if(KEY_PREFETCH_TRACE == key)
+    {
+        verifyFSArgs.options.prefetchTracePath = optionValue(arg);
+        return 0;
+    }
+    else if(KEY_PREFETCH_THREADS == key)
+    {
+        if(!parseThreadCount(optionValue(arg), verifyFSArgs.options.prefetchThreads))
+        {
+            cerr << "Invalid prefetch_threads: " << arg << endl;
+            return -1;
+        }
+
+        return 0;
+    }
+    else if(KEY_VERIFY_ALL == key)
+    {
+        if(!parseThreadCount(optionValue(arg), verifyFSArgs.options.verifyAllThreads))
+        {
+            cerr << "Invalid verify_all: " << arg << endl;
+            return -1;
+        }
+
+        return 0;
+    }
+    else if(KEY_IO_URING == key)
+    {
+        verifyFSArgs.options.useIoUring = true;
+        return 0;
+    }
+    else if(KEY_SPLICE_READ == key)
+    {
+        // fuse splices file descriptor replies into /dev/fuse only when told to splice its writes
+        verifyFSArgs.options.spliceRead = true;
+        fuse_opt_add_arg(outargs, "-osplice_write");
+        return 0;
+    }
+    else if(FUSE_OPT_KEY_NONOPT != key)
     {
         // we're only interested in positionals
         return 1;
     }
-    else if(sourceMountPath.empty())
+    else if(verifyFSArgs.sourceMountPath.empty())
     {
-        sourceMountPath = arg;
+        verifyFSArgs.sourceMountPath = arg;
         return 0;
     }
-    else if(fileHashesPath.empty())
+    else if(verifyFSArgs.fileHashesPath.empty())
     {
-        fileHashesPath = arg;
+        verifyFSArgs.fileHashesPath = arg;
         return 0;
     }
     else
@@ -64,21 +264,46 @@ int verifyFSAdditionalArgs(void* data, const char* arg, int key, struct fuse_arg
 
 int main(int argc, char* argv[])
 {
-    // VerifyFS <sourcefolder> <hashesfile> <mountpoint>
-    string sourceAndHash[2];
+    // VerifyFS <sourcefolder> <hashesfile> <mountpoint> [-o mmap,cache_size=N,stat_timeout=S]
+    VerifyFSArgs verifyFSArgs;
+    verifyFSArgs.options.statisticsSignal = SIGUSR1;
     struct fuse_args args = FUSE_ARGS_INIT(argc, argv);
-    fuse_opt_parse(&args, &sourceAndHash, NULL, verifyFSAdditionalArgs);
+    if(-1 == fuse_opt_parse(&args, &verifyFSArgs, verifyFSOpts, verifyFSAdditionalArgs))
+        return 1;
 
-    // read hashesfile and create a verifier
-    ifstream digestsStream(sourceAndHash[1]);
-    FileVerifier verifier(digestsStream);
+    // read hashesfile, either compiled or shasum formatted, and create a verifier
+    unique_ptr<IFileVerifier> verifier;
+    if(CompiledFileVerifier::isCompiledManifest(verifyFSArgs.fileHashesPath))
+        verifier.reset(new CompiledFileVerifier(verifyFSArgs.fileHashesPath));
+    else
+    {
+        ifstream digestsStream(verifyFSArgs.fileHashesPath);
+        verifier.reset(new FileVerifier(digestsStream));
+    }
+
+    if(!verifyFSArgs.options.prefetchTracePath.empty() && (0 == verifyFSArgs.options.cacheSize))
+        cerr << "prefetch_trace without cache_size only verifies files already open" << endl;
+
+    if(!verifyFSArgs.options.prefetchTracePath.empty() && verifyFSArgs.options.useMmap)
+        cerr << "prefetch_trace has no effect with mmap, which retains nothing" << endl;
+
+    if(verifyFSArgs.options.spliceRead && verifyFSArgs.options.useMmap)
+        cerr << "splice_read has no effect with mmap, which holds no copy" << endl;
+
+    if((0 != verifyFSArgs.options.memfdThreshold) && verifyFSArgs.options.useMmap)
+        cerr << "memfd_threshold has no effect with mmap, which holds no copy" << endl;
+
+    if(verifyFSArgs.options.useIoUring && !isIoUringAvailable())
+        cerr << "io_uring is unavailable, reading with blocking system calls" << endl;
+
+    if((IDigestAlgorithm::sha256 == verifier->digestAlgorithm().id()) && !isSha256Accelerated())
+        cerr << "sha256 is not hardware accelerated on this CPU, consider a sha512-256 or blake3 manifest" << endl;
 
     // create fuse filesystem
-    VerifyFS verifyFS(sourceAndHash[0], verifier);
+    VerifyFS verifyFS(verifyFSArgs.sourceMountPath, *verifier, verifyFSArgs.options);
 
     // activate
     int result = startFuseFSProvider(args.argc, args.argv, &verifyFS);
     fuse_opt_free_args(&args);
     return result;
 }
-
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "gtest/gtest.h"
+#include "AttributeCache.h"
+#include <string.h>
+
+using namespace std;
+
+namespace {
+
+struct stat attributesOfSize(const off_t size)
+{
+    struct stat attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.st_size = size;
+    return attributes;
+}
+
+} // namespace
+
+TEST(AttributeCacheTest, FindsInsertedPaths) {
+    AttributeCache sut(60);
+    sut.insert("a/bob.txt", attributesOfSize(10));
+    sut.insert("", attributesOfSize(20));
+
+    struct stat attributes;
+    EXPECT_TRUE(sut.find("a/bob.txt", attributes));
+    EXPECT_EQ(10, attributes.st_size);
+    EXPECT_TRUE(sut.find("", attributes));
+    EXPECT_EQ(20, attributes.st_size);
+    EXPECT_FALSE(sut.find("a/bob", attributes));
+    EXPECT_FALSE(sut.find("b/wilma.txt", attributes));
+}
+
+TEST(AttributeCacheTest, ReinsertReplacesAttributes) {
+    AttributeCache sut(60);
+    sut.insert("a/bob.txt", attributesOfSize(10));
+    sut.insert("a/bob.txt", attributesOfSize(30));
+
+    struct stat attributes;
+    EXPECT_TRUE(sut.find("a/bob.txt", attributes));
+    EXPECT_EQ(30, attributes.st_size);
+}
+
+TEST(AttributeCacheTest, ExpiredAttributesNotFound) {
+    AttributeCache sut(0);
+    sut.insert("a/bob.txt", attributesOfSize(10));
+
+    struct stat attributes;
+    EXPECT_FALSE(sut.find("a/bob.txt", attributes));
+}
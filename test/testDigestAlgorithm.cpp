@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "gtest/gtest.h"
+#include "DigestAlgorithms.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+string hexDigest(const IDigestAlgorithm& algorithm, const string& data)
+{
+    Digest digest;
+    if(!algorithm.digest(reinterpret_cast<const uint8_t*>(data.data()), data.size(), digest))
+        return "failed";
+
+    return digestToHex(digest);
+}
+
+} // namespace
+
+TEST(DigestAlgorithmTest, Sha256KnownAnswer) {
+    const IDigestAlgorithm* sut = digestAlgorithmNamed("sha256");
+    ASSERT_NE(nullptr, sut);
+
+    EXPECT_EQ(IDigestAlgorithm::sha256, sut->id());
+    EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", hexDigest(*sut, "abc"));
+    EXPECT_EQ(sut, &defaultDigestAlgorithm());
+}
+
+TEST(DigestAlgorithmTest, Sha512_256KnownAnswer) {
+    const IDigestAlgorithm* sut = digestAlgorithmNamed("sha512-256");
+    ASSERT_NE(nullptr, sut);
+
+    EXPECT_EQ(IDigestAlgorithm::sha512_256, sut->id());
+    EXPECT_EQ("53048e2681941ef99b2e29b76b4c7dabe4c2d0c634fc6d46e0e2f13107e7af23", hexDigest(*sut, "abc"));
+}
+
+TEST(DigestAlgorithmTest, LooksUpByNameAndId) {
+    EXPECT_EQ(digestAlgorithmNamed("sha256"), digestAlgorithmWithId(IDigestAlgorithm::sha256));
+    EXPECT_EQ(digestAlgorithmNamed("sha512-256"), digestAlgorithmWithId(IDigestAlgorithm::sha512_256));
+    EXPECT_EQ(digestAlgorithmNamed("blake3"), digestAlgorithmWithId(IDigestAlgorithm::blake3));
+
+    EXPECT_EQ(nullptr, digestAlgorithmNamed("md5"));
+    EXPECT_EQ(nullptr, digestAlgorithmNamed(""));
+    EXPECT_EQ(nullptr, digestAlgorithmWithId(99));
+}
+
+TEST(DigestAlgorithmTest, ContextMatchesOneShot) {
+    const string data = "the quick brown fox jumps over the lazy dog";
+
+    for(const char* name : {"sha256", "sha512-256"})
+    {
+        const IDigestAlgorithm* sut = digestAlgorithmNamed(name);
+        ASSERT_NE(nullptr, sut);
+
+        Digest expected;
+        ASSERT_TRUE(sut->digest(reinterpret_cast<const uint8_t*>(data.data()), data.size(), expected));
+
+        // fed in uneven pieces
+        unique_ptr<IDigestContext> context = sut->createContext();
+        size_t offset;
+        for(offset = 0; offset < data.size(); offset += 7)
+            ASSERT_TRUE(context->update(reinterpret_cast<const uint8_t*>(data.data()) + offset, min<size_t>(7, data.size() - offset)));
+
+        Digest actual;
+        ASSERT_TRUE(context->finish(actual));
+        EXPECT_EQ(expected, actual) << name;
+    }
+}
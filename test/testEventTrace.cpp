@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "gtest/gtest.h"
+#include "EventTrace.h"
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+class EventTraceTest : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        char path[] = "/tmp/testEventTrace.XXXXXX";
+        close(mkstemp(path));
+        mTracePath = path;
+    }
+
+    virtual void TearDown()
+    {
+        unlink(mTracePath.c_str());
+    }
+
+    string readTrace() const
+    {
+        ifstream trace(mTracePath);
+        return string(istreambuf_iterator<char>(trace), istreambuf_iterator<char>());
+    }
+
+    string mTracePath;
+};
+
+size_t countOf(const string& text, const string& pattern)
+{
+    size_t count = 0;
+    size_t at;
+    for(at = text.find(pattern); string::npos != at; at = text.find(pattern, at + 1))
+        count++;
+
+    return count;
+}
+
+} // namespace
+
+TEST_F(EventTraceTest, WritesCompleteEvents) {
+    {
+        EventTrace sut(mTracePath);
+        EventTrace::Scope event(&sut, "fuse", "open", "/a/bob.txt");
+    }
+
+    const string trace = readTrace();
+    EXPECT_EQ(0u, trace.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"));
+    EXPECT_NE(string::npos, trace.find("{\"cat\":\"fuse\",\"name\":\"open\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"));
+    EXPECT_NE(string::npos, trace.find("\"args\":{\"path\":\"/a/bob.txt\"}}\n]}\n"));
+}
+
+TEST_F(EventTraceTest, EscapesPaths) {
+    {
+        EventTrace sut(mTracePath);
+        EventTrace::Scope event(&sut, "fuse", "open", "/a\"b\\c\n");
+    }
+
+    EXPECT_NE(string::npos, readTrace().find("\"path\":\"/a\\\"b\\\\c\\u000a\""));
+}
+
+TEST_F(EventTraceTest, KeepsEachThreadsLatestEvents) {
+    EventTrace sut(mTracePath);
+
+    // one thread overfills its ring, whilst another records a single event
+    size_t i;
+    for(i = 0; i < EventTrace::eventsPerThread + 10; i++)
+        EventTrace::Scope event(&sut, "fuse", (i < 10) ? "oldest" : "read", "/lorem.txt");
+
+    thread([&sut]() { EventTrace::Scope event(&sut, "fuse", "getattr", "/"); }).join();
+
+    sut.write();
+    const string trace = readTrace();
+    EXPECT_EQ(0u, countOf(trace, "\"oldest\""));
+    EXPECT_EQ(EventTrace::eventsPerThread, countOf(trace, "\"name\":\"read\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"));
+    EXPECT_EQ(1u, countOf(trace, "\"name\":\"getattr\",\"ph\":\"X\",\"pid\":1,\"tid\":2,"));
+}
+
+TEST_F(EventTraceTest, ReusesRingsOfExitedThreads) {
+    EventTrace sut(mTracePath);
+
+    // threads started one after another share the first's ring, events and all
+    size_t i;
+    for(i = 0; i < 4; i++)
+        thread([&sut]() { EventTrace::Scope event(&sut, "fuse", "getattr", "/"); }).join();
+
+    sut.write();
+    const string trace = readTrace();
+    EXPECT_EQ(4u, countOf(trace, "\"name\":\"getattr\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"));
+    EXPECT_EQ(0u, countOf(trace, "\"tid\":2,"));
+}
+
+TEST_F(EventTraceTest, ScopeWithoutTraceRecordsNothing) {
+    EventTrace::Scope event(nullptr, "fuse", "open", "/a/bob.txt");
+}
@@ -31,8 +31,15 @@
 
 #include "gtest/gtest.h"
 #include "FileVerifier.h"
+#include "CompiledFileVerifier.h"
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
 #include <sstream>
 #include <vector>
+#include <stdlib.h>
+#include <unistd.h>
 
 // this file is autogenerated by makeTestData
 #include "testAssets.h"
@@ -69,6 +76,47 @@ TEST(FileVerifierTest, DirectoriesPresentInDigest) {
     EXPECT_FALSE(sut.isValidDirectoryPath("dir1/dir2/filename2"));
 }
 
+TEST(FileVerifierTest, LooksUpPathViews) {
+    stringstream digests(fileDirsTree);
+    FileVerifier sut(digests);
+
+    // views need not be terminated, as with a path within a larger buffer
+    const string buffer = "dir1/dir2/filename2/extra";
+    EXPECT_TRUE(sut.isValidDirectoryPath(PathView(buffer.data(), 4)));
+    EXPECT_TRUE(sut.isValidDirectoryPath(PathView(buffer.data(), 9)));
+    EXPECT_TRUE(sut.isValidFilePath(PathView(buffer.data(), 19)));
+    EXPECT_FALSE(sut.isValidFilePath(PathView(buffer.data(), 18)));
+    EXPECT_FALSE(sut.isValidFilePath(PathView(buffer.data(), buffer.length())));
+}
+
+namespace {
+
+string listing(const IFileVerifier& verifier, const PathView& path)
+{
+    vector<IFileVerifier::DirectoryChild> children;
+    if(!verifier.listDirectory(path, children))
+        return "unlisted";
+
+    string names;
+    for(const IFileVerifier::DirectoryChild& child : children)
+        names += child.name.str() + (child.isDirectory ? "/ " : " ");
+
+    return names;
+}
+
+} // namespace
+
+TEST(FileVerifierTest, ListsDirectories) {
+    stringstream digests(fileDirsTree);
+    FileVerifier sut(digests);
+
+    EXPECT_EQ("dir1/ filename0 filename1 ", listing(sut, ""));
+    EXPECT_EQ("dir2/ filename2 ", listing(sut, "dir1"));
+    EXPECT_EQ("filename2 ", listing(sut, "dir1/dir2"));
+    EXPECT_EQ("unlisted", listing(sut, "dir2"));
+    EXPECT_EQ("unlisted", listing(sut, "filename0"));
+}
+
 const vector<uint8_t> fileBlobDigests(digests, digests + digests_len);
 const vector<uint8_t> fileBlob1(blob1, blob1 + blob1_len);
 const vector<uint8_t> fileBlob2(blob2, blob2 + blob2_len);
@@ -93,3 +141,332 @@ TEST(FileVerifierTest, FilesBlobNotPresent) {
     EXPECT_FALSE(sut.isValidFileBlob("dir1/dir2/filename3",  fileBlob1.data(), fileBlob1.size()));
 }
 
+
+const string chunkedDigests = R"(#merkle 64 c7fca94eb4f049781d21a7446a14c88fd14958d7064d425aa3389c10d7d6c82a  dir1/blob1
+#chunk 28863ea022e3f9d4d6ba0e4bd07cf1a9cfa60053ac3232b208d66f831785b7cb
+#chunk da9f3ef852c09417e8557b0d657a25f28334c7ed7260dad6be75bdcaba5f602d
+)";
+
+TEST(FileVerifierTest, ChunkedFilesValid) {
+    stringstream digests(chunkedDigests);
+    FileVerifier sut(digests);
+
+    EXPECT_TRUE(sut.isValidFilePath("dir1/blob1"));
+    EXPECT_TRUE(sut.isValidDirectoryPath("dir1"));
+    EXPECT_EQ(64u, sut.chunkSize("dir1/blob1"));
+    EXPECT_EQ(2u, sut.chunkCount("dir1/blob1"));
+    EXPECT_EQ(0u, sut.chunkSize("blob1"));
+    Digest digest;
+    EXPECT_TRUE(sut.contentDigest("dir1/blob1", digest));
+    EXPECT_EQ("c7fca94eb4f049781d21a7446a14c88fd14958d7064d425aa3389c10d7d6c82a", digestToHex(digest));
+    EXPECT_FALSE(sut.contentDigest("blob1", digest));
+
+    // a merkle root is not a whole file digest
+    EXPECT_TRUE(sut.contentDigest("dir1/blob1", digest));
+    EXPECT_FALSE(sut.isValidFileDigest("dir1/blob1", digest));
+
+    EXPECT_TRUE(sut.isValidFileChunk("dir1/blob1", 0, fileBlob1.data(), 64));
+    EXPECT_TRUE(sut.isValidFileChunk("dir1/blob1", 1, fileBlob1.data() + 64, 64));
+    EXPECT_FALSE(sut.isValidFileChunk("dir1/blob1", 1, fileBlob1.data(), 64));
+    EXPECT_FALSE(sut.isValidFileChunk("dir1/blob1", 2, fileBlob1.data(), 64));
+
+    EXPECT_TRUE(sut.isValidFileBlob("dir1/blob1", fileBlob1.data(), fileBlob1.size()));
+    EXPECT_FALSE(sut.isValidFileBlob("dir1/blob1", fileBlob2.data(), fileBlob2.size()));
+    EXPECT_FALSE(sut.isValidFileBlob("dir1/blob1", fileBlob1.data(), 64));
+}
+
+TEST(FileVerifierTest, MalformedDigest) {
+    stringstream digests("0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEX  filename0\n");
+
+    EXPECT_THROW(FileVerifier sut(digests), runtime_error);
+}
+
+TEST(FileVerifierTest, ChunkedRootMismatch) {
+    string tampered = chunkedDigests;
+    tampered.replace(tampered.find("#chunk ") + 7, 1, "3");
+    stringstream digests(tampered);
+
+    EXPECT_THROW(FileVerifier sut(digests), runtime_error);
+}
+
+// sha512-256 of "abc"
+const string sha512_256Digests = R"(#algorithm sha512-256
+53048e2681941ef99b2e29b76b4c7dabe4c2d0c634fc6d46e0e2f13107e7af23  abc
+)";
+
+const string abc = "abc";
+
+TEST(FileVerifierTest, SelectsDigestAlgorithm) {
+    stringstream digests(sha512_256Digests);
+    FileVerifier sut(digests);
+
+    EXPECT_EQ(IDigestAlgorithm::sha512_256, sut.digestAlgorithm().id());
+    EXPECT_TRUE(sut.isValidFileBlob("abc", reinterpret_cast<const uint8_t*>(abc.data()), abc.size()));
+    EXPECT_FALSE(sut.isValidFileBlob("abc", reinterpret_cast<const uint8_t*>(abc.data()), 2));
+
+    Digest digest;
+    ASSERT_TRUE(sut.contentDigest("abc", digest));
+    EXPECT_TRUE(sut.isValidFileDigest("abc", digest));
+    EXPECT_FALSE(sut.isValidFileDigest("abd", digest));
+    digest[0] ^= 1;
+    EXPECT_FALSE(sut.isValidFileDigest("abc", digest));
+}
+
+TEST(FileVerifierTest, DefaultsToSha256) {
+    stringstream digests(fileDirsTree);
+    FileVerifier sut(digests);
+
+    EXPECT_EQ(IDigestAlgorithm::sha256, sut.digestAlgorithm().id());
+}
+
+TEST(FileVerifierTest, RejectsUnsupportedAlgorithm) {
+    stringstream unknown("#algorithm md5\n");
+    EXPECT_THROW(FileVerifier sut(unknown), runtime_error);
+
+    // the algorithm applies to the whole manifest, so may not follow a digest
+    stringstream late(fileDirsTree + "#algorithm sha512-256\n");
+    EXPECT_THROW(FileVerifier sut(late), runtime_error);
+}
+
+namespace {
+
+// compiles digests into a temporary file, removed again on destruction
+class CompiledDigests
+{
+public:
+    CompiledDigests(const string& digests)
+    {
+        char path[] = "/tmp/testCompiledManifest.XXXXXX";
+        close(mkstemp(path));
+        mPath = path;
+
+        stringstream digestsStream(digests);
+        ofstream compiledStream(mPath, ios::binary | ios::trunc);
+        FileVerifier(digestsStream).compile(compiledStream);
+    }
+
+    ~CompiledDigests()
+    {
+        unlink(mPath.c_str());
+    }
+
+    // rewrites the compiled manifest after edit has changed its bytes
+    void corrupt(const function<void(string& bytes, const CompiledManifestHeader& header)>& edit)
+    {
+        ifstream compiledStream(mPath, ios::binary);
+        string bytes((istreambuf_iterator<char>(compiledStream)), istreambuf_iterator<char>());
+        compiledStream.close();
+
+        const CompiledManifestHeader header = *reinterpret_cast<const CompiledManifestHeader*>(bytes.data());
+        edit(bytes, header);
+        ofstream(mPath, ios::binary | ios::trunc).write(bytes.data(), bytes.size());
+    }
+
+    string mPath;
+};
+
+template<typename Entry>
+Entry& entryAt(string& bytes, const uint64_t table, const uint64_t index)
+{
+    return reinterpret_cast<Entry*>(&bytes[table])[index];
+}
+
+// how many of the paths given a manifest compiled from digests, then corrupted
+// by edit, still lists: files by lookup and directories by listing
+size_t stillListed(const string& digests, const vector<string>& files, const vector<string>& directories,
+                   const function<void(string& bytes, const CompiledManifestHeader& header)>& edit)
+{
+    CompiledDigests compiled(digests);
+    compiled.corrupt(edit);
+    CompiledFileVerifier sut(compiled.mPath);
+
+    size_t listed = 0;
+    for(const string& file : files)
+        listed += sut.isValidFilePath(file) ? 1 : 0;
+
+    vector<IFileVerifier::DirectoryChild> children;
+    for(const string& directory : directories)
+        listed += sut.listDirectory(directory, children) ? 1 : 0;
+
+    return listed;
+}
+
+const vector<string> fileDirsTreeFiles = { "filename0", "filename1", "dir1/filename2", "dir1/dir2/filename2" };
+const vector<string> fileDirsTreeDirectories = { "", "dir1", "dir1/dir2" };
+
+} // namespace
+
+TEST(CompiledFileVerifierTest, FilesAndDirectoriesPresent) {
+    CompiledDigests compiled(fileDirsTree);
+    ASSERT_TRUE(CompiledFileVerifier::isCompiledManifest(compiled.mPath));
+    CompiledFileVerifier sut(compiled.mPath);
+
+    EXPECT_TRUE(sut.isValidFilePath("filename0"));
+    EXPECT_TRUE(sut.isValidFilePath("filename1"));
+    EXPECT_FALSE(sut.isValidFilePath("filename2"));
+    EXPECT_TRUE(sut.isValidFilePath("dir1/filename2"));
+    EXPECT_TRUE(sut.isValidFilePath("dir1/dir2/filename2"));
+    EXPECT_FALSE(sut.isValidFilePath("dir1"));
+    EXPECT_FALSE(sut.isValidFilePath(""));
+
+    EXPECT_TRUE(sut.isValidDirectoryPath("dir1"));
+    EXPECT_TRUE(sut.isValidDirectoryPath("dir1/dir2"));
+    EXPECT_FALSE(sut.isValidDirectoryPath(""));
+    EXPECT_FALSE(sut.isValidDirectoryPath("dir2"));
+    EXPECT_FALSE(sut.isValidDirectoryPath("dir1/filename2"));
+
+    const string buffer = "dir1/dir2/filename2/extra";
+    EXPECT_TRUE(sut.isValidDirectoryPath(PathView(buffer.data(), 9)));
+    EXPECT_TRUE(sut.isValidFilePath(PathView(buffer.data(), 19)));
+    EXPECT_FALSE(sut.isValidFilePath(PathView(buffer.data(), 18)));
+
+    Digest digest;
+    EXPECT_TRUE(sut.contentDigest("filename0", digest));
+    EXPECT_EQ("0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef", digestToHex(digest));
+    EXPECT_FALSE(sut.contentDigest("filename2", digest));
+}
+
+TEST(CompiledFileVerifierTest, ListsDirectories) {
+    CompiledDigests compiled(fileDirsTree);
+    CompiledFileVerifier sut(compiled.mPath);
+
+    EXPECT_EQ("dir1/ filename0 filename1 ", listing(sut, ""));
+    EXPECT_EQ("dir2/ filename2 ", listing(sut, "dir1"));
+    EXPECT_EQ("filename2 ", listing(sut, "dir1/dir2"));
+    EXPECT_EQ("unlisted", listing(sut, "dir2"));
+    EXPECT_EQ("unlisted", listing(sut, "filename0"));
+}
+
+TEST(CompiledFileVerifierTest, FilesBlobValid) {
+    CompiledDigests compiled(string(reinterpret_cast<const char*>(fileBlobDigests.data()), fileBlobDigests.size()));
+    CompiledFileVerifier sut(compiled.mPath);
+
+    EXPECT_TRUE(sut.isValidFileBlob("blob1", fileBlob1.data(), fileBlob1.size()));
+    EXPECT_FALSE(sut.isValidFileBlob("blob2", fileBlob1.data(), fileBlob1.size()));
+    EXPECT_TRUE(sut.isValidFileBlob("blob2", fileBlob2.data(), fileBlob2.size()));
+    EXPECT_FALSE(sut.isValidFileBlob("blob3", fileBlob2.data(), fileBlob2.size()));
+}
+
+TEST(CompiledFileVerifierTest, ChunkedFilesValid) {
+    CompiledDigests compiled(chunkedDigests);
+    CompiledFileVerifier sut(compiled.mPath);
+
+    EXPECT_EQ(64u, sut.chunkSize("dir1/blob1"));
+    EXPECT_EQ(2u, sut.chunkCount("dir1/blob1"));
+    Digest digest;
+    EXPECT_TRUE(sut.contentDigest("dir1/blob1", digest));
+    EXPECT_EQ("c7fca94eb4f049781d21a7446a14c88fd14958d7064d425aa3389c10d7d6c82a", digestToHex(digest));
+
+    EXPECT_TRUE(sut.isValidFileChunk("dir1/blob1", 0, fileBlob1.data(), 64));
+    EXPECT_TRUE(sut.isValidFileChunk("dir1/blob1", 1, fileBlob1.data() + 64, 64));
+    EXPECT_FALSE(sut.isValidFileChunk("dir1/blob1", 1, fileBlob1.data(), 64));
+    EXPECT_TRUE(sut.isValidFileBlob("dir1/blob1", fileBlob1.data(), fileBlob1.size()));
+    EXPECT_FALSE(sut.isValidFileBlob("dir1/blob1", fileBlob2.data(), fileBlob2.size()));
+}
+
+TEST(CompiledFileVerifierTest, KeepsDigestAlgorithm) {
+    CompiledDigests compiled(sha512_256Digests);
+    CompiledFileVerifier sut(compiled.mPath);
+
+    EXPECT_EQ(IDigestAlgorithm::sha512_256, sut.digestAlgorithm().id());
+    EXPECT_TRUE(sut.isValidFileBlob("abc", reinterpret_cast<const uint8_t*>(abc.data()), abc.size()));
+
+    Digest digest;
+    ASSERT_TRUE(sut.contentDigest("abc", digest));
+    EXPECT_TRUE(sut.isValidFileDigest("abc", digest));
+    digest[0] ^= 1;
+    EXPECT_FALSE(sut.isValidFileDigest("abc", digest));
+}
+
+TEST(CompiledFileVerifierTest, RejectsDigestsFile) {
+    char path[] = "/tmp/testCompiledManifest.XXXXXX";
+    const int fh = mkstemp(path);
+    EXPECT_EQ(static_cast<ssize_t>(fileDirsTree.size()), write(fh, fileDirsTree.data(), fileDirsTree.size()));
+    close(fh);
+
+    EXPECT_FALSE(CompiledFileVerifier::isCompiledManifest(path));
+    EXPECT_THROW(CompiledFileVerifier sut(path), runtime_error);
+    unlink(path);
+}
+
+TEST(CompiledFileVerifierTest, UnlistsEntriesOutsideTheirTables) {
+    typedef CompiledManifestFileEntry File;
+    typedef CompiledManifestDirectoryEntry Directory;
+    typedef CompiledManifestChildEntry Child;
+    const auto listed = [](const function<void(string& bytes, const CompiledManifestHeader& header)>& edit) {
+        return stillListed(fileDirsTree, fileDirsTreeFiles, fileDirsTreeDirectories, edit);
+    };
+
+    // entries are only checked when reached, so a corrupt one costs just itself
+    EXPECT_EQ(7u, listed([](string&, const CompiledManifestHeader&) {}));
+
+    EXPECT_EQ(6u, listed([](string& bytes, const CompiledManifestHeader& header) {
+        entryAt<File>(bytes, header.fileTable, 0).pathOffset = header.stringsLength;
+    }));
+    EXPECT_EQ(6u, listed([](string& bytes, const CompiledManifestHeader& header) {
+        File& file = entryAt<File>(bytes, header.fileTable, 0);
+        file.pathLength = header.stringsLength - file.pathOffset + 1;
+    }));
+    EXPECT_EQ(6u, listed([](string& bytes, const CompiledManifestHeader& header) {
+        Directory& directory = entryAt<Directory>(bytes, header.directoryTable, 0);
+        directory.pathLength = header.stringsLength - directory.pathOffset + 1;
+    }));
+    EXPECT_EQ(6u, listed([](string& bytes, const CompiledManifestHeader& header) {
+        entryAt<Directory>(bytes, header.directoryTable, 0).childCount = header.childCount + 1;
+    }));
+    EXPECT_EQ(6u, listed([](string& bytes, const CompiledManifestHeader& header) {
+        entryAt<Child>(bytes, header.childTable, 0).nameOffset = header.stringsLength;
+    }));
+}
+
+TEST(CompiledFileVerifierTest, UnlistsChunksOutsideTheirTable) {
+    typedef CompiledManifestFileEntry File;
+    const auto listed = [](const function<void(string& bytes, const CompiledManifestHeader& header)>& edit) {
+        return stillListed(chunkedDigests, { "dir1/blob1" }, {}, edit);
+    };
+
+    EXPECT_EQ(1u, listed([](string&, const CompiledManifestHeader&) {}));
+    EXPECT_EQ(0u, listed([](string& bytes, const CompiledManifestHeader& header) {
+        entryAt<File>(bytes, header.fileTable, 0).firstChunkDigest = header.chunkDigestCount - 1;
+    }));
+    EXPECT_EQ(0u, listed([](string& bytes, const CompiledManifestHeader& header) {
+        entryAt<File>(bytes, header.fileTable, 0).chunkCount = header.chunkDigestCount + 1;
+    }));
+    EXPECT_EQ(0u, listed([](string& bytes, const CompiledManifestHeader& header) {
+        entryAt<File>(bytes, header.fileTable, 0).chunkSize = 0;
+    }));
+}
+
+TEST(CompiledFileVerifierTest, IgnoresCorruptIndexSlots) {
+    // slots naming entries past the table find nothing
+    EXPECT_EQ(3u, stillListed(fileDirsTree, fileDirsTreeFiles, fileDirsTreeDirectories, [](string& bytes, const CompiledManifestHeader& header) {
+        for(uint64_t slot = 0; slot < header.fileIndexSlotCount; slot++)
+        {
+            PathIndexSlot& indexSlot = entryAt<PathIndexSlot>(bytes, header.fileIndexTable, slot);
+            if(0 != indexSlot.entry)
+                indexSlot.entry = header.fileCount + 1;
+        }
+    }));
+
+    // and with no empty slot, a probe for an unlisted path still ends
+    CompiledDigests compiled(fileDirsTree);
+    compiled.corrupt([](string& bytes, const CompiledManifestHeader& header) {
+        for(uint64_t slot = 0; slot < header.directoryIndexSlotCount; slot++)
+            entryAt<PathIndexSlot>(bytes, header.directoryIndexTable, slot).entry = 1;
+    });
+    CompiledFileVerifier sut(compiled.mPath);
+    EXPECT_FALSE(sut.isValidDirectoryPath("dir2"));
+}
+
+TEST(CompiledFileVerifierTest, BoundsProbesOfAFullIndex) {
+    vector<PathIndexSlot> slots(4);
+    for(PathIndexSlot& slot : slots)
+    {
+        slot.hash = PathIndex::hash("filename0");
+        slot.entry = 1;
+    }
+
+    uint64_t index;
+    EXPECT_FALSE(PathIndex::find(slots.data(), slots.size(), PathIndex::hash("filename1"), [](uint64_t) { return true; }, index));
+    EXPECT_FALSE(PathIndex::find(slots.data(), slots.size(), PathIndex::hash("filename0"), [](uint64_t) { return false; }, index));
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "gtest/gtest.h"
+#include "HeapTrustedContent.h"
+#include "testUntrustedFile.h"
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+TEST(HeapTrustedContentTest, ReadsWithoutHashing) {
+    UntrustedFile file(10000);
+    SyscallReadEngine engine;
+    HeapTrustedContent sut(file.mFd, file.mContent.size(), engine);
+
+    ASSERT_EQ(file.mContent.size(), sut.size());
+    EXPECT_EQ(0, memcmp(file.mContent.data(), sut.data(), sut.size()));
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(sut.data()) % 4096);
+}
+
+TEST(HeapTrustedContentTest, HashesSmallFilesWhilstRead) {
+    expectHashedWhilstRead<HeapTrustedContent>(0);
+    expectHashedWhilstRead<HeapTrustedContent>(1);
+    expectHashedWhilstRead<HeapTrustedContent>((1 << 20) + 3);
+}
+
+TEST(HeapTrustedContentTest, HashesLargeFilesWhilstReadAhead) {
+    expectHashedWhilstRead<HeapTrustedContent>(4 << 20);
+    expectHashedWhilstRead<HeapTrustedContent>((9 << 20) + 12345);
+}
+
+TEST(HeapTrustedContentTest, ShortFileFails) {
+    // the file shrank since its length was taken
+    SyscallReadEngine engine;
+    UntrustedFile small(1000);
+    EXPECT_THROW(HeapTrustedContent sut(small.mFd, 2000, engine), runtime_error);
+
+    UntrustedFile large(5 << 20);
+    unique_ptr<IDigestContext> digest = defaultDigestAlgorithm().createContext();
+    EXPECT_THROW(HeapTrustedContent sut(large.mFd, 6 << 20, engine, digest.get()), runtime_error);
+}
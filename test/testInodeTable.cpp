@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "gtest/gtest.h"
+#include "InodeTable.h"
+
+#include <set>
+
+using namespace std;
+
+TEST(InodeTableTest, RootIsAlwaysKnown) {
+    InodeTable sut;
+
+    string path;
+    EXPECT_TRUE(sut.path(InodeTable::rootInode, path));
+    EXPECT_EQ("/", path);
+
+    sut.forget(InodeTable::rootInode, 1);
+    EXPECT_TRUE(sut.path(InodeTable::rootInode, path));
+    EXPECT_EQ(1u, sut.size());
+}
+
+TEST(InodeTableTest, BuildsChildPaths) {
+    InodeTable sut;
+
+    string path;
+    EXPECT_TRUE(sut.childPath(InodeTable::rootInode, "a", path));
+    EXPECT_EQ("/a", path);
+
+    const uint64_t a = sut.lookup(path);
+    EXPECT_TRUE(sut.childPath(a, "bob.txt", path));
+    EXPECT_EQ("/a/bob.txt", path);
+
+    EXPECT_FALSE(sut.childPath(a + 1, "bob.txt", path));
+}
+
+TEST(InodeTableTest, LookupsShareOneInode) {
+    InodeTable sut;
+
+    const uint64_t first = sut.lookup("/a/bob.txt");
+    EXPECT_NE(InodeTable::rootInode, first);
+    EXPECT_EQ(first, sut.lookup("/a/bob.txt"));
+    EXPECT_NE(first, sut.lookup("/lorem.txt"));
+
+    string path;
+    EXPECT_TRUE(sut.path(first, path));
+    EXPECT_EQ("/a/bob.txt", path);
+}
+
+TEST(InodeTableTest, ForgetsOnceEveryLookupIsForgotten) {
+    InodeTable sut;
+
+    const uint64_t inode = sut.lookup("/a/bob.txt");
+    sut.lookup("/a/bob.txt");
+    sut.lookup("/a/bob.txt");
+
+    string path;
+    sut.forget(inode, 2);
+    EXPECT_TRUE(sut.path(inode, path));
+
+    sut.forget(inode, 1);
+    EXPECT_FALSE(sut.path(inode, path));
+    EXPECT_EQ(1u, sut.size());
+
+    // renumbered, so the forgotten number stays stale
+    EXPECT_NE(inode, sut.lookup("/a/bob.txt"));
+}
+
+TEST(InodeTableTest, FindsWithoutCountingLookups) {
+    InodeTable sut;
+
+    uint64_t inode = 0;
+    EXPECT_FALSE(sut.find("/a/bob.txt", inode));
+
+    const uint64_t bob = sut.lookup("/a/bob.txt");
+    EXPECT_TRUE(sut.find("/a/bob.txt", inode));
+    EXPECT_EQ(bob, inode);
+
+    sut.forget(bob, 1);
+    EXPECT_FALSE(sut.find("/a/bob.txt", inode));
+}
+
+TEST(InodeTableTest, NumbersPathsOfEveryShardDistinctly) {
+    InodeTable sut;
+
+    set<uint64_t> inodes;
+    for(int i = 0; i < 1000; i++)
+    {
+        const string path = "/file" + to_string(i);
+        const uint64_t inode = sut.lookup(path);
+        EXPECT_NE(InodeTable::rootInode, inode);
+        EXPECT_TRUE(inodes.insert(inode).second);
+
+        string found;
+        EXPECT_TRUE(sut.path(inode, found));
+        EXPECT_EQ(path, found);
+    }
+
+    EXPECT_EQ(1001u, sut.size());
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "gtest/gtest.h"
+#include "ReadEngines.h"
+#include "testUntrustedFile.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <memory>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// runs with blocking syscalls, and with io_uring where this kernel permits it
+class ReadEngineTest : public ::testing::TestWithParam<bool>
+{
+protected:
+    ReadEngineTest() :
+        mEngine(createReadEngine(GetParam()))
+    {
+        // initialiser list only
+    }
+
+    bool isSkipped() const
+    {
+        return GetParam() && !isIoUringAvailable();
+    }
+
+    // reads the whole file, recording the blocks in the order handed on
+    bool readFile(const UntrustedFile& file, const size_t length, vector<uint8_t>& buffer, vector<size_t>& offsets)
+    {
+        const int fd = open(file.mPath.c_str(), O_RDONLY);
+        buffer.assign(length, 0);
+        offsets.clear();
+
+        size_t expected = 0;
+        const bool isRead = mEngine->readFile(fd, buffer.data(), length, [&](const size_t offset, const size_t blockLength) {
+            EXPECT_EQ(expected, offset);
+            expected = offset + blockLength;
+            offsets.push_back(offset);
+            return true;
+        });
+
+        close(fd);
+        return isRead;
+    }
+
+    unique_ptr<IReadEngine> mEngine;
+};
+
+} // namespace
+
+TEST_P(ReadEngineTest, OpensAndStatsBatches) {
+    if(isSkipped())
+        return;
+
+    UntrustedFile first(100);
+    UntrustedFile second(5000);
+
+    vector<IReadEngine::OpenRequest> requests;
+    requests.push_back(IReadEngine::OpenRequest(first.mPath));
+    requests.push_back(IReadEngine::OpenRequest("/tmp/testReadEngine.missing"));
+    requests.push_back(IReadEngine::OpenRequest(second.mPath));
+    mEngine->openFiles(requests);
+
+    ASSERT_NE(-1, requests[0].fd);
+    EXPECT_EQ(100, requests[0].details.st_size);
+    EXPECT_EQ(-1, requests[1].fd);
+    EXPECT_EQ(ENOENT, requests[1].error);
+    ASSERT_NE(-1, requests[2].fd);
+    EXPECT_EQ(5000, requests[2].details.st_size);
+
+    // the stat is of the file opened
+    struct stat details;
+    ASSERT_EQ(0, fstat(requests[2].fd, &details));
+    EXPECT_EQ(details.st_dev, requests[2].details.st_dev);
+    EXPECT_EQ(details.st_ino, requests[2].details.st_ino);
+    EXPECT_EQ(details.st_mtim.tv_nsec, requests[2].details.st_mtim.tv_nsec);
+    EXPECT_EQ(details.st_ctim.tv_sec, requests[2].details.st_ctim.tv_sec);
+
+    close(requests[0].fd);
+    close(requests[2].fd);
+}
+
+TEST_P(ReadEngineTest, OpensMoreThanOneBatch) {
+    if(isSkipped())
+        return;
+
+    UntrustedFile file(10);
+    vector<IReadEngine::OpenRequest> requests(200, IReadEngine::OpenRequest(file.mPath));
+    mEngine->openFiles(requests);
+
+    for(const IReadEngine::OpenRequest& request : requests)
+    {
+        ASSERT_NE(-1, request.fd);
+        EXPECT_EQ(10, request.details.st_size);
+        close(request.fd);
+    }
+}
+
+TEST_P(ReadEngineTest, ReadsBlocksInOrder) {
+    if(isSkipped())
+        return;
+
+    for(const size_t length : {size_t(0), size_t(1), size_t(300000), size_t((9 << 20) + 4321)})
+    {
+        UntrustedFile file(length);
+        vector<uint8_t> buffer;
+        vector<size_t> offsets;
+
+        ASSERT_TRUE(readFile(file, length, buffer, offsets));
+        EXPECT_EQ(file.mContent, buffer);
+        EXPECT_EQ(0 == length, offsets.empty());
+    }
+}
+
+TEST_P(ReadEngineTest, ShortFileFails) {
+    if(isSkipped())
+        return;
+
+    UntrustedFile file(3 << 20);
+    vector<uint8_t> buffer;
+    vector<size_t> offsets;
+
+    EXPECT_FALSE(readFile(file, 5 << 20, buffer, offsets));
+}
+
+TEST_P(ReadEngineTest, BlockReadAbandons) {
+    if(isSkipped())
+        return;
+
+    UntrustedFile file(6 << 20);
+    vector<uint8_t> buffer(file.mContent.size());
+    const int fd = open(file.mPath.c_str(), O_RDONLY);
+
+    int blocks = 0;
+    EXPECT_FALSE(mEngine->readFile(fd, buffer.data(), buffer.size(), [&blocks](const size_t, const size_t) {
+        return 2 != ++blocks;
+    }));
+    EXPECT_EQ(2, blocks);
+    close(fd);
+}
+
+INSTANTIATE_TEST_CASE_P(SyscallAndIoUring, ReadEngineTest, ::testing::Bool());
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "gtest/gtest.h"
+#include "SealedTrustedContent.h"
+#include "testUntrustedFile.h"
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+TEST(SealedTrustedContentTest, HashesWhilstRead) {
+    expectHashedWhilstRead<SealedTrustedContent>(0);
+    expectHashedWhilstRead<SealedTrustedContent>(1);
+    expectHashedWhilstRead<SealedTrustedContent>((9 << 20) + 12345);
+}
+
+TEST(SealedTrustedContentTest, SealsContent) {
+    UntrustedFile file(10000);
+    SyscallReadEngine engine;
+    SealedTrustedContent sut(file.mFd, file.mContent.size(), engine);
+
+    // the descriptor reads as the content, and can be neither written nor resized
+    const int fd = sut.sealedFd();
+    ASSERT_NE(-1, fd);
+    vector<uint8_t> content(file.mContent.size());
+    EXPECT_EQ(static_cast<ssize_t>(content.size()), pread(fd, content.data(), content.size(), 0));
+    EXPECT_EQ(file.mContent, content);
+
+    const uint8_t byte = 0;
+    EXPECT_EQ(-1, pwrite(fd, &byte, 1, 0));
+    EXPECT_NE(0, ftruncate(fd, 1));
+    EXPECT_NE(0, ftruncate(fd, 20000));
+    EXPECT_EQ(-1, fcntl(fd, F_ADD_SEALS, F_SEAL_WRITE));
+}
+
+TEST(SealedTrustedContentTest, ShortFileFails) {
+    // the file shrank since its length was taken
+    SyscallReadEngine engine;
+    UntrustedFile small(1000);
+    EXPECT_THROW(SealedTrustedContent sut(small.mFd, 2000, engine), runtime_error);
+}
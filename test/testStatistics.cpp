@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "gtest/gtest.h"
+#include "Statistics.h"
+#include "StatisticsDumper.h"
+#include <signal.h>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+TEST(StatisticsTest, SumsCountersAcrossThreads) {
+    Statistics sut;
+
+    vector<thread> threads;
+    int t;
+    for(t = 0; t < 8; t++)
+    {
+        threads.push_back(thread([&sut]() {
+            int i;
+            for(i = 0; i < 1000; i++)
+            {
+                sut.add(Statistics::opens);
+                sut.add(Statistics::bytesServed, 10);
+            }
+        }));
+    }
+
+    for(thread& th : threads)
+        th.join();
+
+    EXPECT_EQ(8000u, sut.count(Statistics::opens));
+    EXPECT_EQ(80000u, sut.count(Statistics::bytesServed));
+    EXPECT_EQ(0u, sut.count(Statistics::readFailures));
+}
+
+TEST(StatisticsTest, ReportsLatencyPercentiles) {
+    Statistics sut;
+
+    // 90 fast and 10 slow opens
+    int i;
+    for(i = 0; i < 90; i++)
+        sut.record(Statistics::open, 1000);
+    for(i = 0; i < 10; i++)
+        sut.record(Statistics::open, 1000000);
+
+    {
+        Statistics::Timer timer(sut, Statistics::read);
+    }
+
+    EXPECT_EQ(100u, sut.operations(Statistics::open));
+    EXPECT_EQ(1u, sut.operations(Statistics::read));
+    EXPECT_EQ(0u, sut.operations(Statistics::release));
+
+    // each reported as the upper bound of its power of two bucket
+    const string json = sut.json();
+    EXPECT_NE(string::npos, json.find("\"open\": {\"count\": 100, \"mean\": 100900, \"p50\": 1024, \"p90\": 1024, \"p99\": 1048576"));
+    EXPECT_NE(string::npos, json.find("\"release\": {\"count\": 0, \"mean\": 0, \"p50\": 0"));
+    EXPECT_NE(string::npos, json.find("\"opens\": 0"));
+}
+
+TEST(StatisticsTest, DumpsOnSignal) {
+    Statistics sut;
+    sut.add(Statistics::cacheHits, 3);
+
+    ostringstream out;
+    {
+        StatisticsDumper dumper(sut, SIGUSR1, out);
+        raise(SIGUSR1);
+    }
+
+    EXPECT_NE(string::npos, out.str().find("\"cache_hits\": 3"));
+}
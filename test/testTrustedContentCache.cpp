@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "gtest/gtest.h"
+#include "TrustedContentCache.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+class FakeContent : public ITrustedContent
+{
+public:
+    FakeContent(size_t length, bool isRetainable = true) : mBuffer(length), mIsRetainable(isRetainable) {}
+
+    virtual const uint8_t* data() const { return mBuffer.data(); }
+    virtual size_t size() const { return mBuffer.size(); }
+    virtual bool verifyRange(const size_t, const size_t) { return true; }
+    virtual bool isRetainable() const { return mIsRetainable; }
+
+private:
+    vector<uint8_t> mBuffer;
+    const bool mIsRetainable;
+};
+
+Digest hexDigest(const string& digestHex)
+{
+    Digest digest;
+    digestFromHex(digestHex, digest);
+    return digest;
+}
+
+const TrustedContentCache::Key keyA(hexDigest("0df7bc77789e07e344bb478aa7b8e857218e30418b5dee6fdfb953bf5d1fb021"), 0);
+const TrustedContentCache::Key keyB(hexDigest("3871522ca8ed562d8e66be74c299a87b871d588074f6547d3750c3347d35d64c"), 0);
+const TrustedContentCache::Key keyC(hexDigest("5c06028f87263154867f8542ce3fa9d37a8f78e4b1c48a3a3115e4a46e8e6885"), 0);
+const TrustedContentCache::Key keyD(hexDigest("5c06028f87263154867f8542ce3fa9d37a8f78e4b1c48a3a3115e4a46e8e6885"), 1024);
+
+} // namespace
+
+TEST(TrustedContentCacheTest, FindsByDigest) {
+    TrustedContentCache sut(1000);
+    shared_ptr<ITrustedContent> content(new FakeContent(100));
+    sut.insert(keyA, content);
+
+    EXPECT_EQ(content, sut.find(keyA));
+    EXPECT_EQ(nullptr, sut.find(keyB));
+    EXPECT_EQ(100u, sut.size());
+}
+
+TEST(TrustedContentCacheTest, ChunkSizeDistinguishesContent) {
+    TrustedContentCache sut(1000);
+    sut.insert(keyC, shared_ptr<ITrustedContent>(new FakeContent(100)));
+
+    EXPECT_NE(nullptr, sut.find(keyC));
+    EXPECT_EQ(nullptr, sut.find(keyD));
+}
+
+TEST(TrustedContentCacheTest, SharesOpenContentWithoutBudget) {
+    TrustedContentCache sut(0);
+    shared_ptr<ITrustedContent> content(new FakeContent(100));
+    sut.insert(keyA, content);
+
+    EXPECT_EQ(content, sut.find(keyA));
+    EXPECT_EQ(0u, sut.size());
+
+    content.reset();
+    EXPECT_EQ(nullptr, sut.find(keyA));
+}
+
+TEST(TrustedContentCacheTest, SharesUnretainableContentOnlyWhilstOpen) {
+    TrustedContentCache sut(1000);
+    shared_ptr<ITrustedContent> content(new FakeContent(100, false));
+    sut.insert(keyA, content);
+
+    EXPECT_EQ(content, sut.find(keyA));
+    EXPECT_EQ(0u, sut.size());
+
+    content.reset();
+    EXPECT_EQ(nullptr, sut.find(keyA));
+}
+
+TEST(TrustedContentCacheTest, EvictsLeastRecentlyUsed) {
+    TrustedContentCache sut(300);
+    sut.insert(keyA, shared_ptr<ITrustedContent>(new FakeContent(100)));
+    sut.insert(keyB, shared_ptr<ITrustedContent>(new FakeContent(100)));
+    sut.insert(keyC, shared_ptr<ITrustedContent>(new FakeContent(100)));
+
+    // touching A leaves B as the eviction candidate
+    EXPECT_NE(nullptr, sut.find(keyA));
+    sut.insert(keyD, shared_ptr<ITrustedContent>(new FakeContent(150)));
+
+    EXPECT_NE(nullptr, sut.find(keyA));
+    EXPECT_EQ(nullptr, sut.find(keyB));
+    EXPECT_EQ(nullptr, sut.find(keyC));
+    EXPECT_NE(nullptr, sut.find(keyD));
+    EXPECT_EQ(250u, sut.size());
+}
+
+TEST(TrustedContentCacheTest, IgnoresContentLargerThanCapacity) {
+    TrustedContentCache sut(100);
+    sut.insert(keyA, shared_ptr<ITrustedContent>(new FakeContent(101)));
+
+    EXPECT_EQ(nullptr, sut.find(keyA));
+    EXPECT_EQ(0u, sut.size());
+}
+
+TEST(TrustedContentCacheTest, ConcurrentLoadsShareOneLoad) {
+    TrustedContentCache sut(1000);
+    atomic<int> loads(0);
+    auto load = [&loads] {
+        loads++;
+        this_thread::sleep_for(chrono::milliseconds(20));
+        return shared_ptr<ITrustedContent>(new FakeContent(100));
+    };
+
+    vector<shared_ptr<ITrustedContent>> results(4);
+    vector<thread> loaders;
+    size_t i;
+    for(i = 0; i < results.size(); i++)
+        loaders.push_back(thread([&, i] { results[i] = sut.findOrLoad(keyA, load); }));
+    for(thread& t : loaders)
+        t.join();
+
+    EXPECT_EQ(1, loads);
+    for(const shared_ptr<ITrustedContent>& r : results)
+        EXPECT_EQ(results[0], r);
+    EXPECT_EQ(results[0], sut.find(keyA));
+}
+
+TEST(TrustedContentCacheTest, PrunesReleasedOpenContent) {
+    TrustedContentCache sut(0);
+    vector<shared_ptr<ITrustedContent>> held;
+    uint32_t i;
+    for(i = 0; i < 1000; i++)
+    {
+        Digest digest = {};
+        memcpy(digest.data(), &i, sizeof(i));
+
+        // every tenth is still held open
+        shared_ptr<ITrustedContent> content(new FakeContent(10));
+        sut.insert(TrustedContentCache::Key(digest, 0), content);
+        if(0 == (i % 10))
+            held.push_back(content);
+    }
+
+    EXPECT_LE(held.size(), sut.openCount());
+    EXPECT_GE(2 * held.size(), sut.openCount());
+
+    held.clear();
+    for(i = 0; i < 1000; i++)
+    {
+        Digest digest = {};
+        memcpy(digest.data(), &i, sizeof(i));
+        sut.insert(TrustedContentCache::Key(digest, 1), shared_ptr<ITrustedContent>(new FakeContent(10)));
+    }
+
+    EXPECT_GE(128u, sut.openCount());
+}
+
+TEST(TrustedContentCacheTest, FailedLoadsNotInserted) {
+    TrustedContentCache sut(1000);
+    int loads = 0;
+    auto load = [&loads] {
+        loads++;
+        return shared_ptr<ITrustedContent>();
+    };
+
+    EXPECT_EQ(nullptr, sut.findOrLoad(keyA, load));
+    EXPECT_EQ(nullptr, sut.findOrLoad(keyA, load));
+    EXPECT_EQ(2, loads);
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TESTUNTRUSTEDFILE_H
+#define TESTUNTRUSTEDFILE_H
+
+#include "gtest/gtest.h"
+#include "DigestAlgorithms.h"
+#include "SyscallReadEngine.h"
+#include <fcntl.h>
+#include <memory>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// a temporary file of patterned content, removed again on destruction
+class UntrustedFile
+{
+public:
+    UntrustedFile(const size_t length) :
+        mContent(length)
+    {
+        size_t i;
+        for(i = 0; i < length; i++)
+            mContent[i] = static_cast<uint8_t>(i * 31 + (i >> 12));
+
+        char path[] = "/tmp/testUntrustedFile.XXXXXX";
+        const int fh = mkstemp(path);
+        mPath = path;
+        EXPECT_EQ(static_cast<ssize_t>(length), write(fh, mContent.data(), length));
+        close(fh);
+
+        mFd = open(mPath.c_str(), O_RDONLY);
+    }
+
+    ~UntrustedFile()
+    {
+        close(mFd);
+        unlink(mPath.c_str());
+    }
+
+    std::vector<uint8_t> mContent;
+    std::string mPath;
+    int mFd;
+};
+
+// reads a file of the length into the content type, checking both the content
+// and the digest taken whilst it was read
+template<class TrustedContent>
+void expectHashedWhilstRead(const size_t length)
+{
+    UntrustedFile file(length);
+    const IDigestAlgorithm& algorithm = defaultDigestAlgorithm();
+
+    std::unique_ptr<IDigestContext> digest = algorithm.createContext();
+    SyscallReadEngine engine;
+    TrustedContent sut(file.mFd, length, engine, digest.get());
+
+    ASSERT_EQ(length, sut.size());
+    EXPECT_EQ(0, memcmp(file.mContent.data(), sut.data(), length));
+
+    Digest expected;
+    Digest actual;
+    ASSERT_TRUE(algorithm.digest(file.mContent.data(), length, expected));
+    ASSERT_TRUE(digest->finish(actual));
+    EXPECT_EQ(expected, actual);
+}
+
+#endif // TESTUNTRUSTEDFILE_H
@@ -0,0 +1,733 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "gtest/gtest.h"
+#include "VerifyFS.h"
+#include "FileVerifier.h"
+#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const string untrustedPath = TEST_DATA_PATH "/_source";
+const string manifestPath = TEST_DATA_PATH "/_source.manifest";
+const string chunkedManifestPath = TEST_DATA_PATH "/_source.chunked.manifest";
+
+string readUntrusted(const string& path)
+{
+    ifstream f(untrustedPath + path, ios::binary);
+    return string(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+}
+
+string readAll(VerifyFS& sut, const char* path, const size_t chunk = 1000)
+{
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+    fi.flags = O_RDONLY;
+
+    string content;
+    if(0 == sut.fuseOpen(path, &fi))
+    {
+        vector<char> buffer(chunk);
+        int bytesRead;
+        while(0 < (bytesRead = sut.fuseRead(buffer.data(), buffer.size(), content.size(), &fi)))
+            content.append(buffer.data(), bytesRead);
+
+        sut.fuseRelease(&fi);
+    }
+
+    return content;
+}
+
+// reads through fuseReadBuf, following file descriptor buffers as fuse would splice them
+string readAllBufs(VerifyFS& sut, const char* path, const size_t chunk, enum fuse_buf_flags& flags)
+{
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+    fi.flags = O_RDONLY;
+
+    string content;
+    if(0 == sut.fuseOpen(path, &fi))
+    {
+        struct fuse_buf buf;
+        while(0 == sut.fuseReadBuf(buf, chunk, content.size(), &fi))
+        {
+            flags = buf.flags;
+
+            vector<char> data(buf.size);
+            if(0 != (buf.flags & FUSE_BUF_IS_FD))
+                EXPECT_EQ(static_cast<ssize_t>(buf.size), pread(buf.fd, data.data(), buf.size, buf.pos));
+            else
+                memcpy(data.data(), buf.mem, buf.size);
+
+            if(data.empty())
+                break;
+
+            content.append(data.data(), data.size());
+        }
+
+        sut.fuseRelease(&fi);
+    }
+
+    return content;
+}
+
+int collectEntry(void* buf, const char* name, const struct stat*, off_t)
+{
+    static_cast<set<string>*>(buf)->insert(name);
+    return 0;
+}
+
+set<string> listAll(VerifyFS& sut, const char* path)
+{
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+
+    set<string> entries;
+    if(0 == sut.fuseOpendir(path, &fi))
+    {
+        sut.fuseReaddir(path, &entries, collectEntry, 0, &fi);
+        sut.fuseReleasedir(path, &fi);
+    }
+
+    return entries;
+}
+
+// accepts a fixed number of entries per readdir, as a kernel buffer would
+struct PagedListing
+{
+    size_t space;
+    off_t nextOffset;
+    vector<string> names;
+    vector<struct stat> attributes;
+};
+
+int collectPagedEntry(void* buf, const char* name, const struct stat* stbuf, off_t off)
+{
+    PagedListing& listing = *static_cast<PagedListing*>(buf);
+    if(0 == listing.space)
+        return 1;
+
+    listing.space--;
+    listing.nextOffset = off;
+    listing.names.push_back(name);
+    listing.attributes.push_back(*stbuf);
+    return 0;
+}
+
+// several threads share each file, whilst others share the directories
+void stressReaders(VerifyFS& sut, const vector<string>& paths, const int iterations)
+{
+    const size_t readersPerFile = 3;
+
+    vector<string> expected;
+    for(const string& path : paths)
+        expected.push_back(readUntrusted(path));
+    const set<string> expectedRoot = listAll(sut, "/");
+
+    atomic<int> failures(0);
+    vector<thread> threads;
+    size_t t;
+    for(t = 0; t < paths.size() * readersPerFile; t++)
+    {
+        threads.push_back(thread([&, t]() {
+            const size_t p = t % paths.size();
+            int i;
+            for(i = 0; i < iterations; i++)
+            {
+                if(expected[p] != readAll(sut, paths[p].c_str(), 100 + ((i + t) * 97) % 1500))
+                    failures++;
+            }
+        }));
+
+        if(0 != (t % readersPerFile))
+            continue;
+
+        threads.push_back(thread([&]() {
+            int i;
+            for(i = 0; i < iterations; i++)
+            {
+                if(expectedRoot != listAll(sut, "/"))
+                    failures++;
+            }
+        }));
+    }
+
+    for(thread& th : threads)
+        th.join();
+
+    EXPECT_EQ(0, failures.load());
+}
+
+// counts whole file verifications whilst delegating to a real verifier
+class CountingVerifier : public IFileVerifier
+{
+public:
+    CountingVerifier(const IFileVerifier& verifier) : mVerifier(verifier), mBlobsVerified(0) {}
+
+    virtual bool isValidDirectoryPath(const PathView& path) const { return mVerifier.isValidDirectoryPath(path); }
+    virtual bool isValidFilePath(const PathView& path) const { return mVerifier.isValidFilePath(path); }
+    virtual bool isValidFileBlob(const PathView& path, const uint8_t* data, const size_t length) const
+    {
+        mBlobsVerified++;
+        return mVerifier.isValidFileBlob(path, data, length);
+    }
+    virtual bool isValidFileDigest(const PathView& path, const Digest& digest) const
+    {
+        mBlobsVerified++;
+        return mVerifier.isValidFileDigest(path, digest);
+    }
+    virtual const IDigestAlgorithm& digestAlgorithm() const { return mVerifier.digestAlgorithm(); }
+    virtual bool contentDigest(const PathView& path, Digest& digest) const { return mVerifier.contentDigest(path, digest); }
+    virtual size_t chunkSize(const PathView& path) const { return mVerifier.chunkSize(path); }
+    virtual size_t chunkCount(const PathView& path) const { return mVerifier.chunkCount(path); }
+    virtual bool isValidFileChunk(const PathView& path, const size_t index, const uint8_t* data, const size_t length) const
+    {
+        return mVerifier.isValidFileChunk(path, index, data, length);
+    }
+    virtual bool listDirectory(const PathView& path, vector<DirectoryChild>& children) const
+    {
+        return mVerifier.listDirectory(path, children);
+    }
+
+    const IFileVerifier& mVerifier;
+    mutable atomic<int> mBlobsVerified;
+};
+
+const vector<string> stressPaths = { "/lorem.txt", "/lorem1.txt", "/a/bob.txt", "/b/wilma.txt" };
+
+// a private copy of the source tree, for tests that change its files
+class SourceCopy
+{
+public:
+    SourceCopy()
+    {
+        char path[] = "/tmp/testVerifyFS.XXXXXX";
+        mPath = mkdtemp(path);
+        mkdir((mPath + "/a").c_str(), 0755);
+        mkdir((mPath + "/b").c_str(), 0755);
+
+        for(const string& file : stressPaths)
+        {
+            ofstream copy(mPath + file, ios::binary);
+            copy << readUntrusted(file);
+        }
+    }
+
+    ~SourceCopy()
+    {
+        for(const string& file : stressPaths)
+            unlink((mPath + file).c_str());
+
+        rmdir((mPath + "/a").c_str());
+        rmdir((mPath + "/b").c_str());
+        rmdir(mPath.c_str());
+    }
+
+    string mPath;
+};
+
+class VerifyFSTest : public ::testing::TestWithParam<bool>
+{
+protected:
+    VerifyFSTest() :
+        mDigests(manifestPath),
+        mVerifier(mDigests)
+    {
+        mOptions.useMmap = GetParam();
+    }
+
+    ifstream mDigests;
+    FileVerifier mVerifier;
+    VerifyFS::Options mOptions;
+};
+
+} // namespace
+
+TEST_P(VerifyFSTest, ReadsVerifiedFiles) {
+    VerifyFS sut(untrustedPath, mVerifier, mOptions);
+
+    EXPECT_EQ(readUntrusted("/lorem.txt"), readAll(sut, "/lorem.txt"));
+    EXPECT_EQ(readUntrusted("/a/bob.txt"), readAll(sut, "/a/bob.txt"));
+    EXPECT_EQ(readUntrusted("/b/wilma.txt"), readAll(sut, "/b/wilma.txt"));
+}
+
+TEST_P(VerifyFSTest, RequiresSourceFolder) {
+    EXPECT_THROW(VerifyFS(untrustedPath + "/missing", mVerifier, mOptions), runtime_error);
+}
+
+TEST_P(VerifyFSTest, RejectsUnlistedFiles) {
+    VerifyFS sut(untrustedPath, mVerifier, mOptions);
+
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+    fi.flags = O_RDONLY;
+    EXPECT_EQ(-EACCES, sut.fuseOpen("/missing.txt", &fi));
+
+    fi.flags = O_RDWR;
+    EXPECT_EQ(-EACCES, sut.fuseOpen("/lorem.txt", &fi));
+}
+
+TEST_P(VerifyFSTest, StatsUntrustedPaths) {
+    VerifyFS sut(untrustedPath, mVerifier, mOptions);
+
+    // served from the backing tree first, then from memory
+    struct stat expected;
+    ASSERT_EQ(0, stat((untrustedPath + "/a/bob.txt").c_str(), &expected));
+    int i;
+    for(i = 0; i < 2; i++)
+    {
+        struct stat details;
+        ASSERT_EQ(0, sut.fuseStat("/a/bob.txt", &details));
+        EXPECT_EQ(expected.st_size, details.st_size);
+        EXPECT_EQ(expected.st_ino, details.st_ino);
+
+        ASSERT_EQ(0, sut.fuseStat("/a", &details));
+        EXPECT_TRUE(S_ISDIR(details.st_mode));
+        ASSERT_EQ(0, sut.fuseStat("/", &details));
+        EXPECT_TRUE(S_ISDIR(details.st_mode));
+    }
+
+    struct stat details;
+    EXPECT_EQ(-ENOENT, sut.fuseStat("/missing.txt", &details));
+}
+
+TEST_P(VerifyFSTest, ListsOnlyManifestEntries) {
+    // lorem1.txt remains in the untrusted tree but is not listed
+    ifstream manifest(manifestPath);
+    stringstream digests;
+    string line;
+    while(getline(manifest, line))
+    {
+        if(string::npos == line.find("lorem1.txt"))
+            digests << line << '\n';
+    }
+
+    FileVerifier verifier(digests);
+    VerifyFS sut(untrustedPath, verifier, mOptions);
+
+    EXPECT_EQ(set<string>({ ".", "..", "a", "b", "lorem.txt" }), listAll(sut, "/"));
+    EXPECT_EQ(set<string>({ ".", "..", "bob.txt" }), listAll(sut, "/a"));
+
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+    EXPECT_EQ(-ENOENT, sut.fuseOpendir("/missing", &fi));
+
+    struct stat details;
+    EXPECT_EQ(-ENOENT, sut.fuseStat("/lorem1.txt", &details));
+}
+
+TEST_P(VerifyFSTest, PagesDirectoryListings) {
+    VerifyFS sut(untrustedPath, mVerifier, mOptions);
+
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+    ASSERT_EQ(0, sut.fuseOpendir("/", &fi));
+
+    PagedListing listing;
+    listing.nextOffset = 0;
+    int pages;
+    for(pages = 0; pages < 10; pages++)
+    {
+        const size_t listed = listing.names.size();
+        listing.space = 2;
+        ASSERT_EQ(0, sut.fuseReaddir("/", &listing, collectPagedEntry, listing.nextOffset, &fi));
+        if(listed == listing.names.size())
+            break;
+    }
+    EXPECT_EQ(0, sut.fuseReleasedir("/", &fi));
+
+    // three pages of two, every entry exactly once in manifest order, typed by the manifest
+    EXPECT_EQ(vector<string>({ ".", "..", "a", "b", "lorem.txt", "lorem1.txt" }), listing.names);
+    EXPECT_EQ(3, pages);
+    ASSERT_EQ(6u, listing.attributes.size());
+    EXPECT_TRUE(S_ISDIR(listing.attributes[2].st_mode));
+    EXPECT_TRUE(S_ISREG(listing.attributes[4].st_mode));
+}
+
+TEST_P(VerifyFSTest, IndependentHandles) {
+    VerifyFS sut(untrustedPath, mVerifier, mOptions);
+
+    struct fuse_file_info first;
+    memset(&first, 0, sizeof(first));
+    first.flags = O_RDONLY;
+    struct fuse_file_info second = first;
+
+    ASSERT_EQ(0, sut.fuseOpen("/lorem.txt", &first));
+    ASSERT_EQ(0, sut.fuseOpen("/lorem.txt", &second));
+    EXPECT_EQ(0, sut.fuseRelease(&first));
+
+    char buffer[16];
+    EXPECT_EQ(16, sut.fuseRead(buffer, sizeof(buffer), 0, &second));
+    EXPECT_EQ(0, sut.fuseRead(buffer, sizeof(buffer), 1000000, &second));
+    EXPECT_EQ(0, sut.fuseRelease(&second));
+}
+
+TEST_P(VerifyFSTest, ConcurrentReaders) {
+    VerifyFS sut(untrustedPath, mVerifier, mOptions);
+    stressReaders(sut, stressPaths, 200);
+}
+
+TEST_P(VerifyFSTest, ReusesCachedContent) {
+    CountingVerifier verifier(mVerifier);
+    mOptions.cacheSize = 1 << 20;
+    VerifyFS sut(untrustedPath, verifier, mOptions);
+
+    EXPECT_EQ(readUntrusted("/lorem.txt"), readAll(sut, "/lorem.txt"));
+    EXPECT_EQ(readUntrusted("/lorem.txt"), readAll(sut, "/lorem.txt"));
+    EXPECT_EQ(readUntrusted("/a/bob.txt"), readAll(sut, "/a/bob.txt"));
+
+    // lorem1.txt has the same digest as a/bob.txt; mappings are never retained
+    EXPECT_EQ(readUntrusted("/lorem1.txt"), readAll(sut, "/lorem1.txt"));
+    EXPECT_EQ(mOptions.useMmap ? 4 : 2, verifier.mBlobsVerified.load());
+}
+
+TEST_P(VerifyFSTest, SharesIdenticalOpenContent) {
+    CountingVerifier verifier(mVerifier);
+    VerifyFS sut(untrustedPath, verifier, mOptions);
+
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+    fi.flags = O_RDONLY;
+
+    ASSERT_EQ(0, sut.fuseOpen("/a/bob.txt", &fi));
+    EXPECT_EQ(readUntrusted("/lorem1.txt"), readAll(sut, "/lorem1.txt"));
+    EXPECT_EQ(1, verifier.mBlobsVerified.load());
+    EXPECT_EQ(0, sut.fuseRelease(&fi));
+}
+
+TEST_P(VerifyFSTest, UncachedContentReverified) {
+    CountingVerifier verifier(mVerifier);
+    VerifyFS sut(untrustedPath, verifier, mOptions);
+
+    EXPECT_EQ(readUntrusted("/lorem.txt"), readAll(sut, "/lorem.txt"));
+    EXPECT_EQ(readUntrusted("/lorem.txt"), readAll(sut, "/lorem.txt"));
+    EXPECT_EQ(2, verifier.mBlobsVerified.load());
+}
+
+TEST_P(VerifyFSTest, RecordsAndPrefetchesTrace) {
+    char tracePath[] = "/tmp/testAccessTrace.XXXXXX";
+    close(mkstemp(tracePath));
+
+    {
+        mOptions.recordTracePath = tracePath;
+        VerifyFS sut(untrustedPath, mVerifier, mOptions);
+        readAll(sut, "/lorem.txt");
+        readAll(sut, "/a/bob.txt");
+        readAll(sut, "/lorem.txt");
+    }
+
+    ifstream trace(tracePath);
+    EXPECT_EQ("lorem.txt\na/bob.txt\n", string(istreambuf_iterator<char>(trace), istreambuf_iterator<char>()));
+
+    // once prefetched, opens find their content already verified; mappings
+    // are never prefetched, so are verified by the opens instead
+    CountingVerifier verifier(mVerifier);
+    mOptions.recordTracePath.clear();
+    mOptions.prefetchTracePath = tracePath;
+    mOptions.cacheSize = 1 << 20;
+    VerifyFS sut(untrustedPath, verifier, mOptions);
+    sut.fuseInit();
+    sut.waitForBackgroundVerification();
+
+    EXPECT_EQ(readUntrusted("/lorem.txt"), readAll(sut, "/lorem.txt"));
+    EXPECT_EQ(readUntrusted("/a/bob.txt"), readAll(sut, "/a/bob.txt"));
+    EXPECT_EQ(2, verifier.mBlobsVerified);
+    unlink(tracePath);
+}
+
+TEST_P(VerifyFSTest, VerifiesAllAtMount) {
+    CountingVerifier verifier(mVerifier);
+    mOptions.verifyAllThreads = 2;
+    VerifyFS sut(untrustedPath, verifier, mOptions);
+    sut.fuseInit();
+    sut.waitForBackgroundVerification();
+    EXPECT_EQ(0u, sut.verifyAllRemaining());
+    EXPECT_EQ(0u, sut.verifyAllFailures());
+    EXPECT_EQ(4, verifier.mBlobsVerified);
+
+    // nothing is retained, but unchanged files are no longer hashed
+    EXPECT_EQ(readUntrusted("/lorem.txt"), readAll(sut, "/lorem.txt"));
+    EXPECT_EQ(readUntrusted("/a/bob.txt"), readAll(sut, "/a/bob.txt"));
+    EXPECT_EQ(4, verifier.mBlobsVerified);
+}
+
+TEST_P(VerifyFSTest, ReadsThroughIoUring) {
+    // falls back to blocking reads where io_uring is unavailable
+    CountingVerifier verifier(mVerifier);
+    mOptions.useIoUring = true;
+    mOptions.verifyAllThreads = 2;
+    VerifyFS sut(untrustedPath, verifier, mOptions);
+    sut.fuseInit();
+    sut.waitForBackgroundVerification();
+    EXPECT_EQ(0u, sut.verifyAllFailures());
+    EXPECT_EQ(4, verifier.mBlobsVerified);
+
+    stressReaders(sut, stressPaths, 50);
+}
+
+TEST_P(VerifyFSTest, ReadBufRepliesVerifiedMemoryInPlace) {
+    VerifyFS sut(untrustedPath, mVerifier, mOptions);
+
+    enum fuse_buf_flags flags = FUSE_BUF_IS_FD;
+    EXPECT_EQ(readUntrusted("/lorem.txt"), readAllBufs(sut, "/lorem.txt", 700, flags));
+    EXPECT_EQ(0, flags);
+
+    // every read of an open points into the one verified copy it holds
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+    fi.flags = O_RDONLY;
+    ASSERT_EQ(0, sut.fuseOpen("/lorem.txt", &fi));
+
+    struct fuse_buf first;
+    struct fuse_buf second;
+    ASSERT_EQ(0, sut.fuseReadBuf(first, 100, 0, &fi));
+    ASSERT_EQ(0, sut.fuseReadBuf(second, 100, 100, &fi));
+    EXPECT_EQ(static_cast<const char*>(first.mem) + 100, static_cast<const char*>(second.mem));
+    EXPECT_EQ(0, sut.fuseRelease(&fi));
+}
+
+TEST_P(VerifyFSTest, SplicesSealedContent) {
+    mOptions.memfdThreshold = 3000;
+    VerifyFS sut(untrustedPath, mVerifier, mOptions);
+
+    // large files are held sealed, and spliced from, unless mapped
+    enum fuse_buf_flags flags = static_cast<enum fuse_buf_flags>(0);
+    EXPECT_EQ(readUntrusted("/lorem.txt"), readAllBufs(sut, "/lorem.txt", 700, flags));
+    EXPECT_EQ(mOptions.useMmap ? 0 : FUSE_BUF_IS_FD, flags & FUSE_BUF_IS_FD);
+    EXPECT_EQ(readUntrusted("/lorem.txt"), readAll(sut, "/lorem.txt"));
+
+    // and smaller files copied from the heap
+    ASSERT_GT(3000u, readUntrusted("/a/bob.txt").size());
+    flags = FUSE_BUF_IS_FD;
+    EXPECT_EQ(readUntrusted("/a/bob.txt"), readAllBufs(sut, "/a/bob.txt", 700, flags));
+    EXPECT_EQ(0, flags);
+}
+
+TEST_P(VerifyFSTest, SplicesSealedPreverifiedFiles) {
+    CountingVerifier verifier(mVerifier);
+    mOptions.verifyAllThreads = 2;
+    mOptions.spliceRead = true;
+    SourceCopy source;
+    VerifyFS sut(source.mPath, verifier, mOptions);
+    sut.fuseInit();
+    sut.waitForBackgroundVerification();
+    ASSERT_EQ(0u, sut.verifyAllRemaining());
+
+    // sealed copies are spliced, unless mapped, without hashing them again
+    enum fuse_buf_flags flags = static_cast<enum fuse_buf_flags>(0);
+    EXPECT_EQ(readUntrusted("/a/bob.txt"), readAllBufs(sut, "/a/bob.txt", 700, flags));
+    EXPECT_EQ(mOptions.useMmap ? 0 : FUSE_BUF_IS_FD, flags & FUSE_BUF_IS_FD);
+    EXPECT_EQ(readUntrusted("/a/bob.txt"), readAll(sut, "/a/bob.txt"));
+    EXPECT_EQ(4, verifier.mBlobsVerified);
+
+    // a change since verified never reaches files already open
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+    fi.flags = O_RDONLY;
+    ASSERT_EQ(0, sut.fuseOpen("/a/bob.txt", &fi));
+
+    // replaced by an identical file, which is nonetheless a different identity
+    const string untrustedFile = source.mPath + "/a/bob.txt";
+    {
+        ofstream replacement(untrustedFile + ".new", ios::binary);
+        replacement << readUntrusted("/a/bob.txt");
+    }
+    ASSERT_EQ(0, rename((untrustedFile + ".new").c_str(), untrustedFile.c_str()));
+
+    char buffer[100];
+    EXPECT_EQ(static_cast<int>(sizeof(buffer)), sut.fuseRead(buffer, sizeof(buffer), 0, &fi));
+    EXPECT_EQ(0, memcmp(readUntrusted("/a/bob.txt").data(), buffer, sizeof(buffer)));
+    EXPECT_EQ(0, sut.fuseRelease(&fi));
+
+    // and later opens verify it afresh
+    EXPECT_EQ(readUntrusted("/a/bob.txt"), readAll(sut, "/a/bob.txt"));
+    EXPECT_EQ(5, verifier.mBlobsVerified);
+}
+
+TEST_P(VerifyFSTest, ServesStatistics) {
+    VerifyFS sut(untrustedPath, mVerifier, mOptions);
+    EXPECT_EQ(readUntrusted("/lorem.txt"), readAll(sut, "/lorem.txt"));
+    EXPECT_EQ(readUntrusted("/lorem.txt"), readAll(sut, "/lorem.txt"));
+    EXPECT_EQ("", readAll(sut, "/unlisted.txt"));
+
+    EXPECT_EQ(2u, sut.statistics().count(Statistics::opens));
+    EXPECT_EQ(1u, sut.statistics().count(Statistics::openFailures));
+    EXPECT_EQ(2u, sut.statistics().count(Statistics::cacheLoads));
+    EXPECT_EQ(2 * readUntrusted("/lorem.txt").size(), sut.statistics().count(Statistics::bytesServed));
+    EXPECT_EQ(3u, sut.statistics().operations(Statistics::open));
+
+    // found by lookup without appearing in listings
+    struct stat attributes;
+    ASSERT_EQ(0, sut.fuseStat("/.verifyfs", &attributes));
+    EXPECT_TRUE(S_ISDIR(attributes.st_mode));
+    ASSERT_EQ(0, sut.fuseStat("/.verifyfs/stats", &attributes));
+    EXPECT_TRUE(S_ISREG(attributes.st_mode));
+    EXPECT_EQ(set<string>({ ".", "..", "stats" }), listAll(sut, "/.verifyfs"));
+    EXPECT_EQ(0u, listAll(sut, "/").count(".verifyfs"));
+
+    // lookups and forgets are timed apart from getattr
+    ASSERT_EQ(0, sut.fuseLookup("/lorem.txt", &attributes));
+    EXPECT_TRUE(S_ISREG(attributes.st_mode));
+    EXPECT_EQ(-ENOENT, sut.fuseLookup("/unlisted.txt", &attributes));
+    sut.fuseForget("/lorem.txt", 1);
+    EXPECT_EQ(2u, sut.statistics().operations(Statistics::lookup));
+    EXPECT_EQ(1u, sut.statistics().operations(Statistics::forget));
+    EXPECT_EQ(2u, sut.statistics().operations(Statistics::getattr));
+
+    const string report = readAll(sut, "/.verifyfs/stats");
+    EXPECT_NE(string::npos, report.find("\"opens\": 2,"));
+    EXPECT_NE(string::npos, report.find("\"open_failures\": 1,"));
+    EXPECT_NE(string::npos, report.find("\"open\": {\"count\": 3,"));
+}
+
+TEST_P(VerifyFSTest, AppendsStatisticsToFile) {
+    char statisticsPath[] = "/tmp/testStatistics.XXXXXX";
+    close(mkstemp(statisticsPath));
+    mOptions.statisticsSignal = SIGUSR1;
+    mOptions.statisticsPath = statisticsPath;
+    {
+        VerifyFS sut(untrustedPath, mVerifier, mOptions);
+        sut.fuseInit();
+        EXPECT_EQ(readUntrusted("/lorem.txt"), readAll(sut, "/lorem.txt"));
+        raise(SIGUSR1);
+        raise(SIGUSR1);
+    }
+
+    // each dump requested is written before the mount is gone
+    ifstream statisticsStream(statisticsPath);
+    const string statistics((istreambuf_iterator<char>(statisticsStream)), istreambuf_iterator<char>());
+    const size_t first = statistics.find("\"opens\": 1,");
+    ASSERT_NE(string::npos, first);
+    EXPECT_NE(string::npos, statistics.find("\"opens\": 1,", first + 1));
+    unlink(statisticsPath);
+}
+
+TEST_P(VerifyFSTest, TracesEvents) {
+    char tracePath[] = "/tmp/testEventTrace.XXXXXX";
+    close(mkstemp(tracePath));
+
+    {
+        mOptions.eventTracePath = tracePath;
+        VerifyFS sut(untrustedPath, mVerifier, mOptions);
+        readAll(sut, "/a/bob.txt");
+    }
+
+    // written once unmounted, each event with the path it concerns
+    ifstream trace(tracePath);
+    const string events(istreambuf_iterator<char>(trace), (istreambuf_iterator<char>()));
+    EXPECT_NE(string::npos, events.find("{\"cat\":\"fuse\",\"name\":\"open\","));
+    EXPECT_NE(string::npos, events.find("{\"cat\":\"fuse\",\"name\":\"read\","));
+    EXPECT_NE(string::npos, events.find("{\"cat\":\"verify\",\"name\":\"openat\","));
+    EXPECT_NE(string::npos, events.find("{\"cat\":\"verify\",\"name\":\"load\","));
+    EXPECT_NE(string::npos, events.find("\"args\":{\"path\":\"/a/bob.txt\"}"));
+    EXPECT_NE(string::npos, events.find("\"args\":{\"path\":\"a/bob.txt\"}"));
+    unlink(tracePath);
+}
+
+TEST_P(VerifyFSTest, KeepsKernelCacheOfVerifiedContent) {
+    VerifyFS sut(untrustedPath, mVerifier, mOptions);
+
+    struct fuse_file_info fi;
+    memset(&fi, 0, sizeof(fi));
+    fi.flags = O_RDONLY;
+    ASSERT_EQ(0, sut.fuseOpen("/lorem.txt", &fi));
+
+    // a mapping reads through to the untrusted file, so is never kept
+    EXPECT_EQ(mOptions.useMmap ? 0u : 1u, fi.keep_cache);
+    EXPECT_EQ(0u, fi.direct_io);
+    EXPECT_EQ(0, sut.fuseRelease(&fi));
+}
+
+TEST_P(VerifyFSTest, InvalidatesFilesFailingVerification) {
+    mOptions.verifyAllThreads = 2;
+    SourceCopy source;
+    {
+        ofstream corrupt(source.mPath + "/a/bob.txt", ios::binary | ios::app);
+        corrupt << "corrupt";
+    }
+
+    VerifyFS sut(source.mPath, mVerifier, mOptions);
+    mutex invalidatedLock;
+    vector<string> invalidated;
+    sut.fuseSetInvalidator([&invalidatedLock, &invalidated](const char* path) {
+        lock_guard<mutex> lock(invalidatedLock);
+        invalidated.push_back(path);
+    });
+
+    sut.fuseInit();
+    sut.waitForBackgroundVerification();
+    EXPECT_EQ(1u, sut.verifyAllFailures());
+    EXPECT_EQ(vector<string>({ "/a/bob.txt" }), invalidated);
+    sut.fuseSetInvalidator(VerifyFS::Invalidator());
+}
+
+TEST_P(VerifyFSTest, ConcurrentCachedReaders) {
+    mOptions.cacheSize = 4096;
+    VerifyFS sut(untrustedPath, mVerifier, mOptions);
+    stressReaders(sut, stressPaths, 200);
+}
+
+INSTANTIATE_TEST_CASE_P(HeapAndMmap, VerifyFSTest, ::testing::Bool());
+
+TEST(VerifyFSChunkedTest, ReadsChunkedFiles) {
+    ifstream digests(chunkedManifestPath);
+    FileVerifier verifier(digests);
+    VerifyFS sut(untrustedPath, verifier);
+
+    // read sizes that straddle chunk boundaries
+    EXPECT_EQ(readUntrusted("/lorem.txt"), readAll(sut, "/lorem.txt", 700));
+    EXPECT_EQ(readUntrusted("/a/bob.txt"), readAll(sut, "/a/bob.txt", 4096));
+    EXPECT_EQ(readUntrusted("/b/wilma.txt"), readAll(sut, "/b/wilma.txt", 1));
+}
+
+TEST(VerifyFSChunkedTest, ConcurrentReaders) {
+    ifstream digests(chunkedManifestPath);
+    FileVerifier verifier(digests);
+    VerifyFS sut(untrustedPath, verifier);
+
+    stressReaders(sut, stressPaths, 200);
+}
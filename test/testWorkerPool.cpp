@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2015, Cognitive-i Ltd (verifyfs@cognitive-i.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this
+ *    list of conditions and the following disclaimer in the documentation and/or
+ *    other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may
+ *    be used to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "gtest/gtest.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+using namespace std;
+
+TEST(WorkerPoolTest, RunsEverySubmittedTask) {
+    WorkerPool sut(3);
+    atomic<int> runs(0);
+
+    int i;
+    for(i = 0; i < 100; i++)
+        sut.submit([&runs] { runs++; });
+
+    sut.wait();
+    EXPECT_EQ(100, runs);
+}
+
+TEST(WorkerPoolTest, SingleThreadRunsInSubmissionOrder) {
+    WorkerPool sut(1);
+    vector<int> order;
+
+    int i;
+    for(i = 0; i < 10; i++)
+        sut.submit([&order, i] { order.push_back(i); });
+
+    sut.wait();
+    EXPECT_EQ(vector<int>({ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }), order);
+}
+
+TEST(WorkerPoolTest, DestructionDropsQueuedTasks) {
+    atomic<int> runs(0);
+    {
+        WorkerPool sut(1);
+        int i;
+        for(i = 0; i < 10; i++)
+            sut.submit([&runs] { runs++; this_thread::sleep_for(chrono::milliseconds(10)); });
+    }
+
+    EXPECT_LT(runs, 10);
+}